@@ -0,0 +1,207 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MemoryStats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef Q_OS_WIN
+#include <malloc.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Constant initialized, so that allocations made before main are counted as well
+static std::atomic<quint64> s_allocationCount(0);
+static std::atomic<quint64> s_allocationBytes(0);
+
+static void* countedAlloc(std::size_t size) noexcept
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	s_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size)
+{
+	void* ptr = countedAlloc(size);
+	if(!ptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+#ifdef __cpp_aligned_new
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) noexcept
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	s_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	std::size_t align = qMax(static_cast<std::size_t>(alignment), sizeof(void*));
+#ifdef Q_OS_WIN
+	return _aligned_malloc(size ? size : 1, align);
+#else
+	void* ptr = nullptr;
+	return posix_memalign(&ptr, align, size ? size : 1) == 0 ? ptr : nullptr;
+#endif
+}
+
+static void alignedFree(void* ptr) noexcept
+{
+#ifdef Q_OS_WIN
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* ptr = countedAlignedAlloc(size, alignment);
+	if(!ptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAlignedAlloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAlignedAlloc(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(ptr);
+}
+#endif
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+namespace MemoryStats {
+
+Allocations allocations()
+{
+	Allocations result;
+	result.count = s_allocationCount.load(std::memory_order_relaxed);
+	result.bytes = s_allocationBytes.load(std::memory_order_relaxed);
+	return result;
+}
+
+qint64 peakResidentSize()
+{
+#ifdef Q_OS_WIN
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))){
+		return qint64(counters.PeakWorkingSetSize);
+	}
+	return -1;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0){
+		return -1;
+	}
+#ifdef Q_OS_MACOS
+	// Bytes on macOS, kilobytes elsewhere
+	return qint64(usage.ru_maxrss);
+#else
+	return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+} // MemoryStats
@@ -0,0 +1,65 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_MEMORYSTATS_HPP
+#define QTSPELL_MEMORYSTATS_HPP
+
+#include <QtGlobal>
+
+/**
+ * @brief Memory accounting for the benchmarks. Linking this utility replaces
+ *        the global operator new and delete of the program with counting
+ *        versions, which also count the allocations made by QtSpell and Qt.
+ *        Allocations made with malloc, i.e. by enchant and hunspell, are not
+ *        counted.
+ * @note The counts are only complete on Linux and other ELF platforms. On
+ *       Windows, the replacement only applies to the benchmark executable,
+ *       the allocations made inside the QtSpell and Qt DLLs are not counted.
+ */
+namespace MemoryStats {
+
+/**
+ * @brief The allocations made since the program started.
+ */
+struct Allocations {
+	quint64 count = 0;
+	quint64 bytes = 0;
+
+	Allocations operator-(const Allocations& other) const{
+		Allocations diff;
+		diff.count = count - other.count;
+		diff.bytes = bytes - other.bytes;
+		return diff;
+	}
+};
+
+/**
+ * @brief Returns the allocations made so far, by all threads.
+ * @return The number and total size of the allocations.
+ */
+Allocations allocations();
+
+/**
+ * @brief Returns the peak resident set size of the process.
+ * @return The peak resident set size in bytes, or -1 if unknown.
+ */
+qint64 peakResidentSize();
+
+} // MemoryStats
+
+#endif // QTSPELL_MEMORYSTATS_HPP
@@ -0,0 +1,115 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares the spelling backends on the same dictionary:
+//   backend_benchmark <lang> <word list> [iterations]
+// The word list contains one word per line, i.e. a text split into words. Each word is checked once
+// as it is and once with two letters swapped, and suggestions are requested for some of the latter.
+
+#include "QtSpell.hpp"
+#include "MemoryStats.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <cstdio>
+
+struct Words {
+	QList<QString> text;
+	QList<QByteArray> utf8;
+};
+
+static void benchmark(const char* name, QtSpell::Backend* backend, const QString& lang, const Words& words, const Words& misspellings, int iterations)
+{
+	QElapsedTimer timer;
+	timer.start();
+	QtSpell::Dictionary* dict = backend->requestDictionary(lang);
+	if(!dict){
+		std::printf("%-10s dictionary for %s not available\n", name, qPrintable(lang));
+		return;
+	}
+	double loadMs = timer.nsecsElapsed() / 1e6;
+
+	int misspelled = 0;
+	MemoryStats::Allocations before = MemoryStats::allocations();
+	timer.restart();
+	for(int i = 0; i < iterations; ++i){
+		for(const QByteArray& word : words.utf8){
+			misspelled += !dict->check(word.constData(), word.size());
+		}
+	}
+	double checkNs = double(timer.nsecsElapsed()) / (qint64(iterations) * words.utf8.size());
+	double checkAllocs = double((MemoryStats::allocations() - before).count) / (qint64(iterations) * words.utf8.size());
+
+	const int suggestCount = qMin(100, misspellings.text.size());
+	before = MemoryStats::allocations();
+	timer.restart();
+	for(int i = 0; i < suggestCount; ++i){
+		dict->suggest(misspellings.text[i]);
+	}
+	double suggestUs = suggestCount > 0 ? timer.nsecsElapsed() / 1e3 / suggestCount : 0.;
+	double suggestAllocs = suggestCount > 0 ? double((MemoryStats::allocations() - before).count) / suggestCount : 0.;
+
+	std::printf("%-10s load %9.2f ms   check %9.1f ns/word %6.2f allocs/word   suggest %9.1f us/word %8.1f allocs/word   misspelled %d\n",
+				name, loadMs, checkNs, checkAllocs, suggestUs, suggestAllocs, misspelled / iterations);
+	delete dict;
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	if(argc < 3){
+		std::fprintf(stderr, "Usage: %s <lang> <word list> [iterations]\n", argv[0]);
+		return 1;
+	}
+	QString lang = QString::fromLocal8Bit(argv[1]);
+	int iterations = argc > 3 ? qMax(1, atoi(argv[3])) : 10;
+
+	QFile file(QString::fromLocal8Bit(argv[2]));
+	if(!file.open(QIODevice::ReadOnly)){
+		std::fprintf(stderr, "Failed to open %s: %s\n", argv[2], qPrintable(file.errorString()));
+		return 1;
+	}
+	Words words;
+	Words misspellings;
+	while(!file.atEnd()){
+		QString word = QString::fromUtf8(file.readLine().trimmed());
+		if(word.length() < 2){
+			continue;
+		}
+		words.text.append(word);
+		words.utf8.append(word.toUtf8());
+		QString swapped = word;
+		std::swap(swapped[0], swapped[1]);
+		misspellings.text.append(swapped);
+		misspellings.utf8.append(swapped.toUtf8());
+	}
+	Words all = words;
+	all.text += misspellings.text;
+	all.utf8 += misspellings.utf8;
+	std::printf("%d words, %d iterations\n", int(all.utf8.size()), iterations);
+
+	benchmark("enchant", QtSpell::Backend::getDefault(), lang, all, misspellings, iterations);
+	QtSpell::Backend* hunspell = QtSpell::Backend::createHunspellBackend();
+	if(hunspell){
+		benchmark("hunspell", hunspell, lang, all, misspellings, iterations);
+		delete hunspell;
+	}
+	std::printf("peak RSS %.1f MiB\n", MemoryStats::peakResidentSize() / 1048576.);
+	return 0;
+}
@@ -0,0 +1,164 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Replays an editing session recorded with TextEditChecker::setEditRecording in an offscreen QTextEdit,
+// and reports the latency of the edits. The latency of an edit includes the processing of the events
+// posted while applying it. The memory used by the run is reported as well: the allocations per edit,
+// the growth of the format collection of the document, the undo/redo history and the peak RSS.
+
+#include "QtSpell.hpp"
+#include "MemoryStats.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextCursor>
+#include <QTextEdit>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+
+static QString unescapeRecordedText(const QByteArray& field)
+{
+	QString text = QString::fromUtf8(field);
+	QString unescaped;
+	unescaped.reserve(text.length());
+	for(int i = 0, n = text.length(); i < n; ++i){
+		if(text[i] == QLatin1Char('\\') && i + 1 < n){
+			QChar next = text[++i];
+			unescaped += next == QLatin1Char('t') ? QChar('\t') : next == QLatin1Char('n') ? QChar('\n') : next;
+		}else{
+			unescaped += text[i];
+		}
+	}
+	return unescaped;
+}
+
+static double percentile(const QVector<qint64>& sorted, int p)
+{
+	return sorted.isEmpty() ? 0. : sorted[qMin(sorted.size() - 1, sorted.size() * p / 100)] / 1e3;
+}
+
+int main(int argc, char* argv[])
+{
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replays a recorded editing session and reports the per-edit latency.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("recording", "The recorded editing session.");
+	QCommandLineOption langOption("lang", "The spell checking language.", "lang");
+	QCommandLineOption realtimeOption("realtime", "Replay the edits at their recorded pace, so that background work runs between them.");
+	QCommandLineOption noUndoOption("no-undo", "Disable the undo/redo stack.");
+	parser.addOption(langOption);
+	parser.addOption(realtimeOption);
+	parser.addOption(noUndoOption);
+	parser.process(app);
+	if(parser.positionalArguments().size() != 1){
+		parser.showHelp(1);
+	}
+
+	QFile file(parser.positionalArguments().first());
+	if(!file.open(QIODevice::ReadOnly)){
+		std::fprintf(stderr, "Failed to open %s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+		return 1;
+	}
+
+	QTextEdit textEdit;
+	textEdit.resize(800, 600);
+	textEdit.show();
+	QtSpell::TextEditChecker checker;
+	if(parser.isSet(langOption) && !checker.setLanguage(parser.value(langOption))){
+		std::fprintf(stderr, "Failed to set language %s\n", qPrintable(parser.value(langOption)));
+		return 1;
+	}
+	checker.setTextEdit(&textEdit);
+	checker.setUndoRedoEnabled(!parser.isSet(noUndoOption));
+
+	QVector<qint64> latencies;
+	int initialFormats = -1;
+	MemoryStats::Allocations editAllocations;
+	QElapsedTimer replayTimer;
+	replayTimer.start();
+	qint64 recordingOffset = 0;
+	while(!file.atEnd()){
+		QByteArray line = file.readLine();
+		if(line.endsWith('\n')){
+			line.chop(1);
+		}
+		QList<QByteArray> fields = line.split('\t');
+		if(fields.size() == 2 && fields[0] == "T"){
+			textEdit.setPlainText(unescapeRecordedText(fields[1]));
+			app.processEvents();
+			continue;
+		}
+		if(fields.size() != 5 || fields[0] != "E"){
+			continue;
+		}
+		qint64 time = fields[1].toLongLong();
+		int pos = fields[2].toInt();
+		int removed = fields[3].toInt();
+		QString added = unescapeRecordedText(fields[4]);
+		if(parser.isSet(realtimeOption)){
+			if(latencies.isEmpty()){
+				recordingOffset = time - replayTimer.elapsed();
+			}
+			while(replayTimer.elapsed() + recordingOffset < time){
+				app.processEvents();
+				QThread::msleep(1);
+			}
+		}
+
+		if(initialFormats < 0){
+			initialFormats = textEdit.document()->allFormats().size();
+		}
+		int last = textEdit.document()->characterCount() - 1;
+		QTextCursor cursor(textEdit.document());
+		cursor.setPosition(qMin(pos, last));
+		cursor.setPosition(qMin(pos + removed, last), QTextCursor::KeepAnchor);
+		MemoryStats::Allocations before = MemoryStats::allocations();
+		QElapsedTimer timer;
+		timer.start();
+		if(added.isEmpty()){
+			cursor.removeSelectedText();
+		}else{
+			cursor.insertText(added);
+		}
+		app.processEvents();
+		latencies.append(timer.nsecsElapsed());
+		MemoryStats::Allocations diff = MemoryStats::allocations() - before;
+		editAllocations.count += diff.count;
+		editAllocations.bytes += diff.bytes;
+	}
+
+	QVector<qint64> sorted = latencies;
+	std::sort(sorted.begin(), sorted.end());
+	std::printf("%d edits, latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+				int(sorted.size()), percentile(sorted, 50), percentile(sorted, 99), sorted.isEmpty() ? 0. : sorted.last() / 1e3);
+	if(!sorted.isEmpty()){
+		std::printf("allocations per edit %.1f (%.0f bytes)\n", double(editAllocations.count) / sorted.size(), double(editAllocations.bytes) / sorted.size());
+		std::printf("document formats %d -> %d\n", initialFormats, int(textEdit.document()->allFormats().size()));
+	}
+	std::printf("undo/redo history %.1f KiB, peak RSS %.1f MiB\n", checker.undoRedoMemoryUsage() / 1024., MemoryStats::peakResidentSize() / 1048576.);
+	return 0;
+}
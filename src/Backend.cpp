@@ -0,0 +1,165 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "QtSpell.hpp"
+#include "EnchantBackend.hpp"
+#include "MemoryBackend.hpp"
+#ifdef QTSPELL_HUNSPELL
+#include "HunspellBackend.hpp"
+#endif
+
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <QtDebug>
+
+namespace QtSpell {
+
+// Holds the backend used by all checkers, the enchant backend is only created if no other backend was set
+struct DefaultBackend {
+	Backend* backend = nullptr;
+	// The threads preloading dictionaries of the backend, which must finish before it is deleted
+	QMutex preloadMutex;
+	QList<QPointer<QThread>> preloads;
+	// The languages of the backend, as listing them scans all dictionaries
+	QMutex languagesMutex;
+	QList<QString> languages;
+	bool languagesValid = false;
+
+	~DefaultBackend(){
+		waitForPreloads();
+		delete backend;
+	}
+
+	void waitForPreloads(){
+		QList<QPointer<QThread>> running;
+		{
+			QMutexLocker locker(&preloadMutex);
+			running.swap(preloads);
+		}
+		for(const QPointer<QThread>& thread : qAsConst(running)){
+			if(thread){
+				thread->wait();
+			}
+		}
+	}
+};
+
+static DefaultBackend& get_default_backend_holder() {
+	static DefaultBackend defaultBackend;
+	return defaultBackend;
+}
+
+static Backend*& get_default_backend() {
+	return get_default_backend_holder().backend;
+}
+
+void Dictionary::storeReplacement(const QString& /*misspelling*/, const QString& /*replacement*/)
+{
+}
+
+bool Backend::hasLanguage(const QString& lang)
+{
+	return listLanguages().contains(lang);
+}
+
+void Backend::preload(const QString& /*lang*/)
+{
+}
+
+void Backend::setDefault(Backend* backend)
+{
+	Backend*& defaultBackend = get_default_backend();
+	if(backend != defaultBackend){
+		get_default_backend_holder().waitForPreloads();
+		invalidateDefaultLanguages();
+		delete defaultBackend;
+		defaultBackend = backend;
+	}
+}
+
+Backend* Backend::getDefault()
+{
+	Backend*& defaultBackend = get_default_backend();
+	if(!defaultBackend){
+		defaultBackend = new EnchantBackend();
+	}
+	return defaultBackend;
+}
+
+void Backend::preloadDefault(const QList<QString>& langs)
+{
+	Backend* backend = getDefault();
+	QThread* thread = QThread::create([backend, langs]{
+		for(const QString& lang : langs){
+			backend->preload(lang);
+		}
+	});
+	DefaultBackend& holder = get_default_backend_holder();
+	{
+		QMutexLocker locker(&holder.preloadMutex);
+		holder.preloads.append(thread);
+	}
+	QObject::connect(thread, &QThread::finished, thread, [thread]{
+		DefaultBackend& holder = get_default_backend_holder();
+		{
+			QMutexLocker locker(&holder.preloadMutex);
+			holder.preloads.removeAll(thread);
+		}
+		thread->deleteLater();
+	});
+	thread->start(QThread::LowPriority);
+}
+
+QList<QString> Backend::defaultLanguages()
+{
+	DefaultBackend& holder = get_default_backend_holder();
+	QMutexLocker locker(&holder.languagesMutex);
+	if(!holder.languagesValid){
+		holder.languages = getDefault()->listLanguages();
+		holder.languagesValid = true;
+	}
+	return holder.languages;
+}
+
+void Backend::invalidateDefaultLanguages()
+{
+	DefaultBackend& holder = get_default_backend_holder();
+	QMutexLocker locker(&holder.languagesMutex);
+	holder.languages.clear();
+	holder.languagesValid = false;
+}
+
+Backend* Backend::createMemoryBackend(const QMap<QString, QList<QString>>& wordLists)
+{
+	return new MemoryBackend(wordLists);
+}
+
+Backend* Backend::createHunspellBackend(const QList<QString>& searchPaths)
+{
+#ifdef QTSPELL_HUNSPELL
+	return new HunspellBackend(searchPaths);
+#else
+	Q_UNUSED(searchPaths)
+	qWarning() << "QtSpell was built without hunspell support";
+	return nullptr;
+#endif
+}
+
+} // QtSpell
@@ -19,36 +19,22 @@
 #include "QtSpell.hpp"
 #include "Checker_p.hpp"
 #include "Codetable.hpp"
+#include "PersonalDictionaryWriter.hpp"
+#include "SuggestionIndex.hpp"
+#include "WordIndex.hpp"
+#include "WordSet.hpp"
 
-#include <enchant++.h>
 #include <QActionGroup>
 #include <QApplication>
+#include <QDir>
+#include <QFile>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QMenu>
+#include <QStandardPaths>
 #include <QTranslator>
 #include <QtDebug>
 
-static void dict_describe_cb(const char* const lang_tag,
-							 const char* const /*provider_name*/,
-							 const char* const /*provider_desc*/,
-							 const char* const /*provider_file*/,
-							 void* user_data)
-{
-	QList<QString>* languages = static_cast<QList<QString>*>(user_data);
-	languages->append(lang_tag);
-}
-
-static enchant::Broker* get_enchant_broker() {
-#ifdef QTSPELL_ENCHANT2
-    static enchant::Broker broker;
-    return &broker;
-#else
-    return enchant::Broker::instance();
-#endif
-}
-
-
 class TranslationsInit {
 public:
 	TranslationsInit(){
@@ -76,13 +62,23 @@ private:
 
 namespace QtSpell {
 
+// Maximum number of suggestions taken from the suggestion index
+static const int MaxIndexSuggestions = 15;
+// Maximum number of verdicts cached for the checkers of a group
+static const int MaxVerdicts = 100000;
+
 CheckerPrivate::CheckerPrivate()
+	: ownKnownWords(new WordSet())
+	, knownWords(ownKnownWords)
 {
 }
 
 CheckerPrivate::~CheckerPrivate()
 {
-	delete speller;
+	delete wordIndex;
+	delete suggestionIndex;
+	delete ownKnownWords;
+	delete languagesMenu;
 }
 
 void CheckerPrivate::init()
@@ -90,12 +86,100 @@ void CheckerPrivate::init()
 	static TranslationsInit tsInit;
 	Q_UNUSED(tsInit);
 
+	initLanguage();
+}
+
+void CheckerPrivate::initLanguage()
+{
 	setLanguageInternal("");
 }
 
+void CheckerPrivate::recheckWord(const QString& /*word*/, int start, int end)
+{
+	Q_Q(Checker);
+	q->checkSpelling(start, end);
+}
+
+void CheckerPrivate::recheckAll()
+{
+	Q_Q(Checker);
+	q->checkSpelling();
+}
+
+void CheckerPrivate::recheckAllSharingDictionary()
+{
+	recheckAll();
+}
+
+static QString replacementsPath(const QString& lang)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/qtspell/replacements/" + lang + ".txt";
+}
+
+void CheckerPrivate::loadReplacements(const QString& lang, QHash<QString, QString>& replacements)
+{
+	// One tab separated pair per line, later lines override earlier ones
+	replacements.clear();
+	QFile file(replacementsPath(lang));
+	if(!file.open(QIODevice::ReadOnly)){
+		return;
+	}
+	int lines = 0;
+	while(!file.atEnd()){
+		QList<QByteArray> pair = file.readLine().trimmed().split('\t');
+		++lines;
+		if(pair.size() == 2 && !pair[0].isEmpty() && !pair[1].isEmpty()){
+			replacements.insert(QString::fromUtf8(pair[0]), QString::fromUtf8(pair[1]));
+		}
+	}
+	file.close();
+	// Files written by earlier versions may contain overridden or invalid pairs
+	if(lines > replacements.size()){
+		saveReplacements(lang, replacements);
+	}
+}
+
+void CheckerPrivate::saveReplacements(const QString& lang, const QHash<QString, QString>& replacements)
+{
+	// Only the last replacement of each misspelling is kept, so the file doesn't grow with each choice. The file
+	// is written in the background, like the added words.
+	QByteArray contents;
+	for(auto it = replacements.cbegin(), itEnd = replacements.cend(); it != itEnd; ++it){
+		contents += it.key().toUtf8() + '\t' + it.value().toUtf8() + '\n';
+	}
+	PersonalDictionaryWriter::instance()->replaceFile(replacementsPath(lang), contents);
+}
+
+void CheckerPrivate::updateLanguagesMenu()
+{
+	Q_Q(Checker);
+	QList<QString> langs = Checker::getLanguageList();
+	if(langs != languagesMenuLangs || decodeCodes != languagesMenuDecoded || languagesMenu->isEmpty()){
+		languagesMenu->clear();
+		QActionGroup* actionGroup = languagesMenu->findChild<QActionGroup*>();
+		if(!actionGroup){
+			actionGroup = new QActionGroup(languagesMenu);
+		}
+		for(const QString& l : langs){
+			QString text = decodeCodes ? Checker::decodeLanguageCode(l) : l;
+			QAction* action = new QAction(text, languagesMenu);
+			action->setData(l);
+			action->setCheckable(true);
+			QObject::connect(action, &QAction::triggered, q, &Checker::slotSetLanguage);
+			languagesMenu->addAction(action);
+			actionGroup->addAction(action);
+		}
+		languagesMenuLangs = langs;
+		languagesMenuDecoded = decodeCodes;
+	}
+	for(QAction* action : languagesMenu->actions()){
+		action->setChecked(action->data().toString() == lang);
+	}
+}
+
 bool checkLanguageInstalled(const QString &lang)
 {
-	return get_enchant_broker()->dict_exists(lang.toStdString());
+	return Backend::getDefault()->hasLanguage(lang);
 }
 
 Checker::Checker(QObject* parent)
@@ -124,7 +208,7 @@ bool Checker::setLanguage(const QString &lang)
 	Q_D(Checker);
 	bool success = d->setLanguageInternal(lang);
 	if(isAttached()){
-		checkSpelling();
+		d->recheckAll();
 	}
 	return success;
 }
@@ -135,10 +219,47 @@ QString Checker::getLanguage() const
 	return d->lang;
 }
 
+void CheckerPrivate::resetDictionary()
+{
+	speller.reset();
+	verdicts.reset();
+	// The word and suggestion indexes belong to the previous language
+	delete wordIndex;
+	wordIndex = nullptr;
+	delete suggestionIndex;
+	suggestionIndex = nullptr;
+	ownReplacements.clear();
+	ownKnownWords->clear();
+}
+
+void CheckerPrivate::dictionaryLoaded()
+{
+	loadReplacements(lang, *replacements);
+	// The ignored words apply to any language, the added words only to the dictionary they were added to
+	for(const QString& word : qAsConst(*ignoredWords)){
+		speller->addToSession(word);
+		int length = encodeUtf8(word);
+		knownWords->insert(utf8Scratch.constData(), length);
+	}
+}
+
+void CheckerPrivate::setSharedDictionary(const QString& newLang, const QSharedPointer<Dictionary>& dictionary, const QSharedPointer<QHash<QByteArray, bool>>& sharedVerdicts,
+										 QHash<QString, QString>* sharedReplacements, QSet<QString>* sharedIgnoredWords, WordSet* sharedKnownWords)
+{
+	// The owner of the shared dictionary loads the replacements and adds the ignored words to its session and
+	// the known words
+	resetDictionary();
+	lang = dictionary ? newLang : QString();
+	speller = dictionary;
+	verdicts = sharedVerdicts;
+	replacements = sharedReplacements;
+	ignoredWords = sharedIgnoredWords;
+	knownWords = sharedKnownWords;
+}
+
 bool CheckerPrivate::setLanguageInternal(const QString &newLang)
 {
-	delete speller;
-	speller = nullptr;
+	resetDictionary();
 	lang = newLang;
 
 	// Determine language from system locale
@@ -152,13 +273,12 @@ bool CheckerPrivate::setLanguageInternal(const QString &newLang)
 	}
 
 	// Request dictionary
-	try {
-		speller = get_enchant_broker()->request_dict(lang.toStdString());
-	} catch(enchant::Exception& e) {
-		qWarning() << "Failed to load dictionary: " << e.what();
+	speller.reset(Backend::getDefault()->requestDictionary(lang));
+	if(!speller){
 		lang = QString();
 		return false;
 	}
+	dictionaryLoaded();
 
 	return true;
 }
@@ -193,58 +313,257 @@ bool Checker::getSpellingEnabled() const
 	return d->spellingEnabled;
 }
 
+void Checker::setAutoCorrectEnabled(bool enabled)
+{
+	Q_D(Checker);
+	d->autoCorrect = enabled;
+}
+
+bool Checker::getAutoCorrectEnabled() const
+{
+	Q_D(const Checker);
+	return d->autoCorrect;
+}
+
+void Checker::storeReplacement(const QString& misspelling, const QString& replacement)
+{
+	Q_D(Checker);
+	if(!d->speller || misspelling.isEmpty() || replacement.isEmpty() || misspelling.contains('\t') || replacement.contains('\t') ||
+	   d->replacements->value(misspelling) == replacement){
+		return;
+	}
+	d->replacements->insert(misspelling, replacement);
+	d->speller->storeReplacement(misspelling, replacement);
+	CheckerPrivate::saveReplacements(d->lang, *d->replacements);
+}
+
 void Checker::addWordToDictionary(const QString &word)
 {
 	Q_D(Checker);
 	if(d->speller){
-		d->speller->add(word.toUtf8().data());
+		d->speller->add(word);
+		int length = d->encodeUtf8(word);
+		d->knownWords->insert(d->utf8Scratch.constData(), length);
+		if(d->verdicts){
+			d->verdicts->insert(QByteArray(d->utf8Scratch.constData(), length), true);
+		}
 	}
 }
 
 bool Checker::checkWord(const QString &word) const
 {
 	Q_D(const Checker);
-	if(!d->speller || !d->spellingEnabled){
+	return d->checkWord(word);
+}
+
+bool CheckerPrivate::checkWord(QStringView word) const
+{
+	if(!speller || !spellingEnabled){
 		return true;
 	}
 	// Skip empty strings and single characters
 	if(word.length() < 2){
 		return true;
 	}
-	try{
-		return d->speller->check(word.toUtf8().data());
-	}catch(const enchant::Exception&){
+	int length = encodeUtf8(word);
+	// Ignored and added words are known to be correct, without asking the dictionary
+	if(knownWords->contains(utf8Scratch.constData(), length)){
 		return true;
 	}
+	// Common correct words are found in the index, only look up the others in the dictionary
+	if(wordIndex && wordIndex->contains(utf8Scratch.constData(), length)){
+		return true;
+	}
+	if(!verdicts){
+		return speller->check(utf8Scratch.constData(), length);
+	}
+	// The checkers of a group share the verdicts, so that each distinct word is only looked up once
+	auto it = verdicts->constFind(QByteArray::fromRawData(utf8Scratch.constData(), length));
+	if(it != verdicts->constEnd()){
+		return it.value();
+	}
+	bool correct = speller->check(utf8Scratch.constData(), length);
+	if(verdicts->size() >= MaxVerdicts){
+		verdicts->clear();
+	}
+	verdicts->insert(QByteArray(utf8Scratch.constData(), length), correct);
+	return correct;
+}
+
+int CheckerPrivate::encodeUtf8(QStringView text) const
+{
+	// The buffer only ever grows, so that encoding words doesn't allocate once it is large enough
+	int capacity = text.length() * 3 + 1;
+	if(utf8Scratch.size() < capacity){
+		utf8Scratch.resize(qMax(capacity, 256));
+	}
+	char* out = utf8Scratch.data();
+	int length = 0;
+	for(int i = 0, n = text.length(); i < n; ++i){
+		uint ucs4 = text[i].unicode();
+		if(text[i].isHighSurrogate() && i + 1 < n && text[i + 1].isLowSurrogate()){
+			ucs4 = QChar::surrogateToUcs4(text[i], text[i + 1]);
+			++i;
+		}
+		if(ucs4 < 0x80){
+			out[length++] = char(ucs4);
+		}else if(ucs4 < 0x800){
+			out[length++] = char(0xC0 | (ucs4 >> 6));
+			out[length++] = char(0x80 | (ucs4 & 0x3F));
+		}else if(ucs4 < 0x10000){
+			out[length++] = char(0xE0 | (ucs4 >> 12));
+			out[length++] = char(0x80 | ((ucs4 >> 6) & 0x3F));
+			out[length++] = char(0x80 | (ucs4 & 0x3F));
+		}else{
+			out[length++] = char(0xF0 | (ucs4 >> 18));
+			out[length++] = char(0x80 | ((ucs4 >> 12) & 0x3F));
+			out[length++] = char(0x80 | ((ucs4 >> 6) & 0x3F));
+			out[length++] = char(0x80 | (ucs4 & 0x3F));
+		}
+	}
+	out[length] = '\0';
+	return length;
+}
+
+bool Checker::setWordIndex(const QString& indexPath)
+{
+	Q_D(Checker);
+	delete d->wordIndex;
+	d->wordIndex = nullptr;
+	if(indexPath.isEmpty()){
+		return true;
+	}
+	d->wordIndex = new WordIndex();
+	if(!d->wordIndex->load(indexPath)){
+		delete d->wordIndex;
+		d->wordIndex = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool Checker::buildWordIndex(const QString& wordListPath, const QString& indexPath)
+{
+	return WordIndex::build(wordListPath, indexPath);
+}
+
+bool Checker::setSuggestionIndex(const QString& indexPath)
+{
+	Q_D(Checker);
+	delete d->suggestionIndex;
+	d->suggestionIndex = nullptr;
+	if(indexPath.isEmpty()){
+		return true;
+	}
+	d->suggestionIndex = new SuggestionIndex();
+	if(!d->suggestionIndex->load(indexPath)){
+		delete d->suggestionIndex;
+		d->suggestionIndex = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void Checker::setMergeSuggestions(bool merge)
+{
+	Q_D(Checker);
+	d->mergeSuggestions = merge;
+}
+
+bool Checker::getMergeSuggestions() const
+{
+	Q_D(const Checker);
+	return d->mergeSuggestions;
+}
+
+bool Checker::buildSuggestionIndex(const QString& wordListPath, const QString& indexPath, int maxDistance)
+{
+	return SuggestionIndex::build(wordListPath, indexPath, maxDistance);
 }
 
 void Checker::ignoreWord(const QString &word) const
 {
 	Q_D(const Checker);
-	d->speller->add_to_session(word.toUtf8().data());
+	d->ignoredWords->insert(word);
+	if(d->speller){
+		d->speller->addToSession(word);
+		int length = d->encodeUtf8(word);
+		d->knownWords->insert(d->utf8Scratch.constData(), length);
+		if(d->verdicts){
+			d->verdicts->insert(QByteArray(d->utf8Scratch.constData(), length), true);
+		}
+	}
+}
+
+QList<QString> Checker::getIgnoredWords() const
+{
+	Q_D(const Checker);
+	QList<QString> words = d->ignoredWords->values();
+	std::sort(words.begin(), words.end());
+	return words;
+}
+
+void Checker::setIgnoredWords(const QList<QString>& words)
+{
+	Q_D(Checker);
+	// The filter can't forget words, so it is rebuilt from the remaining ignored words. Added words are
+	// dropped from it, they are still found by the dictionary.
+	d->knownWords->clear();
+	for(const QString& word : qAsConst(*d->ignoredWords)){
+		if(d->speller && !words.contains(word)){
+			d->speller->removeFromSession(word);
+		}
+	}
+	if(d->verdicts){
+		d->verdicts->clear();
+	}
+	d->ignoredWords->clear();
+	for(const QString& word : words){
+		ignoreWord(word);
+	}
+	// The words are ignored by all checkers sharing the dictionary
+	if(isAttached()){
+		d->recheckAllSharingDictionary();
+	}
 }
 
 QList<QString> Checker::getSpellingSuggestions(const QString& word) const
 {
 	Q_D(const Checker);
 	QList<QString> list;
-	if(d->speller){
-		std::vector<std::string> suggestions;
-		d->speller->suggest(word.toUtf8().data(), suggestions);
-		for(std::size_t i = 0, n = suggestions.size(); i < n; ++i){
-			list.append(QString::fromUtf8(suggestions[i].c_str()));
+	// Unless merging, the dictionary is only asked for suggestions if the index has none, as this is much slower
+	if(d->suggestionIndex){
+		list = d->suggestionIndex->suggest(word, MaxIndexSuggestions);
+	}
+	if((list.isEmpty() || d->mergeSuggestions) && d->speller){
+		for(const QString& suggestion : d->speller->suggest(word)){
+			if(!list.contains(suggestion)){
+				list.append(suggestion);
+			}
 		}
 	}
+	// A replacement chosen before is the most likely one
+	QString replacement = d->replacements->value(word);
+	if(!replacement.isEmpty()){
+		list.removeAll(replacement);
+		list.prepend(replacement);
+	}
 	return list;
 }
 
 QList<QString> Checker::getLanguageList()
 {
-	enchant::Broker* broker = get_enchant_broker();
-	QList<QString> languages;
-	broker->list_dicts(dict_describe_cb, &languages);
-	std::sort(languages.begin(), languages.end());
-	return languages;
+	return Backend::defaultLanguages();
+}
+
+void Checker::refreshLanguageList()
+{
+	Backend::invalidateDefaultLanguages();
+}
+
+void Checker::preloadDictionaries(const QList<QString>& langs)
+{
+	Backend::preloadDefault(langs);
 }
 
 QString Checker::decodeLanguageCode(const QString &lang)
@@ -266,7 +585,7 @@ void Checker::setSpellingEnabled(bool enabled)
 {
 	Q_D(Checker);
 	d->spellingEnabled = enabled;
-	checkSpelling();
+	d->recheckAll();
 }
 
 void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
@@ -276,30 +595,65 @@ void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
 	if(d->speller && d->spellingEnabled){
 		QString word = getWord(wordPos);
 
-		if(!checkWord(word)) {
-			QList<QString> suggestions = getSpellingSuggestions(word);
-			if(!suggestions.isEmpty()){
-				for(int i = 0, n = qMin(10, suggestions.length()); i < n; ++i){
-					QAction* action = new QAction(suggestions[i], menu);
-					action->setProperty("wordPos", wordPos);
-					action->setProperty("suggestion", suggestions[i]);
-					connect(action, &QAction::triggered, this, &Checker::slotReplaceWord);
-					menu->insertAction(insertPos, action);
-				}
-				if(suggestions.length() > 10) {
-					QMenu* moreMenu = new QMenu();
-					for(int i = 10, n = suggestions.length(); i < n; ++i){
-						QAction* action = new QAction(suggestions[i], moreMenu);
+		QString replacement = d->replacements->value(word);
+		bool misspelled = !checkWord(word);
+		if(misspelled) {
+			if(!replacement.isEmpty()) {
+				// The replacement chosen before is offered right away, the dictionary is only asked for the
+				// other suggestions when they are requested
+				QAction* action = new QAction(replacement, menu);
+				action->setProperty("wordPos", wordPos);
+				action->setProperty("suggestion", replacement);
+				connect(action, &QAction::triggered, this, &Checker::slotReplaceWord);
+				menu->insertAction(insertPos, action);
+				QMenu* moreMenu = new QMenu(menu);
+				connect(moreMenu, &QMenu::aboutToShow, this, [this, moreMenu, word, wordPos, replacement]{
+					if(!moreMenu->isEmpty()){
+						return;
+					}
+					for(const QString& suggestion : getSpellingSuggestions(word)){
+						if(suggestion == replacement){
+							continue;
+						}
+						QAction* action = new QAction(suggestion, moreMenu);
 						action->setProperty("wordPos", wordPos);
-						action->setProperty("suggestion", suggestions[i]);
+						action->setProperty("suggestion", suggestion);
 						connect(action, &QAction::triggered, this, &Checker::slotReplaceWord);
 						moreMenu->addAction(action);
 					}
-					QAction* action = new QAction(tr("More..."), menu);
-					menu->insertAction(insertPos, action);
-					action->setMenu(moreMenu);
-				}
+					if(moreMenu->isEmpty()){
+						moreMenu->addAction(tr("No suggestions"))->setEnabled(false);
+					}
+				});
+				QAction* moreAction = new QAction(tr("More suggestions"), menu);
+				menu->insertAction(insertPos, moreAction);
+				moreAction->setMenu(moreMenu);
 				menu->insertSeparator(insertPos);
+			}else{
+				QList<QString> suggestions = getSpellingSuggestions(word);
+				if(!suggestions.isEmpty()){
+					for(int i = 0, n = qMin(10, suggestions.length()); i < n; ++i){
+						QAction* action = new QAction(suggestions[i], menu);
+						action->setProperty("wordPos", wordPos);
+						action->setProperty("suggestion", suggestions[i]);
+						connect(action, &QAction::triggered, this, &Checker::slotReplaceWord);
+						menu->insertAction(insertPos, action);
+					}
+					if(suggestions.length() > 10) {
+						QMenu* moreMenu = new QMenu();
+						for(int i = 10, n = suggestions.length(); i < n; ++i){
+							QAction* action = new QAction(suggestions[i], moreMenu);
+							action->setProperty("wordPos", wordPos);
+							action->setProperty("suggestion", suggestions[i]);
+							connect(action, &QAction::triggered, this, &Checker::slotReplaceWord);
+							moreMenu->addAction(action);
+						}
+						QAction* action = new QAction(tr("More..."), menu);
+						menu->insertAction(insertPos, action);
+						action->setMenu(moreMenu);
+					}
+					menu->insertSeparator(insertPos);
+				}
 			}
 
 			QAction* addAction = new QAction(tr("Add \"%1\" to dictionary").arg(word), menu);
@@ -322,20 +676,12 @@ void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
 		menu->insertAction(insertPos, action);
 	}
 	if(d->speller && d->spellingEnabled){
-		QMenu* languagesMenu = new QMenu();
-		QActionGroup* actionGroup = new QActionGroup(languagesMenu);
-		foreach(const QString& lang, getLanguageList()){
-			QString text = getDecodeLanguageCodes() ? decodeLanguageCode(lang) : lang;
-			QAction* action = new QAction(text, languagesMenu);
-			action->setData(lang);
-			action->setCheckable(true);
-			action->setChecked(lang == getLanguage());
-			connect(action, &QAction::triggered, this, &Checker::slotSetLanguage);
-			languagesMenu->addAction(action);
-			actionGroup->addAction(action);
+		if(!d->languagesMenu){
+			d->languagesMenu = new QMenu();
+			connect(d->languagesMenu, &QMenu::aboutToShow, this, [d]{ d->updateLanguagesMenu(); });
 		}
 		QAction* langsAction = new QAction(tr("Languages"), menu);
-		langsAction->setMenu(languagesMenu);
+		langsAction->setMenu(d->languagesMenu);
 		menu->insertAction(insertPos, langsAction);
 		menu->insertSeparator(insertPos);
 	}
@@ -346,18 +692,22 @@ void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
 
 void Checker::slotAddWord()
 {
+	Q_D(Checker);
 	int wordPos = qobject_cast<QAction*>(QObject::sender())->data().toInt();
 	int start, end;
-	addWordToDictionary(getWord(wordPos, &start, &end));
-	checkSpelling(start, end);
+	QString word = getWord(wordPos, &start, &end);
+	addWordToDictionary(word);
+	d->recheckWord(word, start, end);
 }
 
 void Checker::slotIgnoreWord()
 {
+	Q_D(Checker);
 	int wordPos = qobject_cast<QAction*>(QObject::sender())->data().toInt();
 	int start, end;
-	ignoreWord(getWord(wordPos, &start, &end));
-	checkSpelling(start, end);
+	QString word = getWord(wordPos, &start, &end);
+	ignoreWord(word);
+	d->recheckWord(word, start, end);
 }
 
 void Checker::slotReplaceWord()
@@ -365,8 +715,10 @@ void Checker::slotReplaceWord()
 	QAction* action = qobject_cast<QAction*>(QObject::sender());
 	int wordPos = action->property("wordPos").toInt();
 	int start, end;
-	getWord(wordPos, &start, &end);
-	insertWord(start, end, action->property("suggestion").toString());
+	QString word = getWord(wordPos, &start, &end);
+	QString suggestion = action->property("suggestion").toString();
+	storeReplacement(word, suggestion);
+	insertWord(start, end, suggestion);
 }
 
 void Checker::slotSetLanguage(bool checked)
@@ -0,0 +1,222 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "QtSpell.hpp"
+#include "CheckerGroup_p.hpp"
+#include "TextEditChecker_p.hpp"
+
+#include <QLocale>
+#include <QPlainTextEdit>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QtDebug>
+
+namespace QtSpell {
+
+CheckerGroupPrivate::CheckerGroupPrivate(CheckerGroup* group)
+	: q_ptr(group)
+{
+}
+
+bool CheckerGroupPrivate::setLanguage(const QString& newLang)
+{
+	lang = newLang;
+	speller.reset();
+
+	// Determine language from system locale
+	if(lang.isEmpty()){
+		lang = QLocale::system().name();
+		if(lang.toLower() == "c" || lang.isEmpty()){
+			qWarning() << "Cannot use system locale " << lang;
+			lang = QString();
+		}
+	}
+
+	// Request the dictionary once for all checkers
+	if(!lang.isEmpty()){
+		speller.reset(Backend::getDefault()->requestDictionary(lang));
+		if(!speller){
+			lang = QString();
+		}
+	}
+	verdicts.reset(speller ? new QHash<QByteArray, bool>() : nullptr);
+	replacements.clear();
+	knownWords.clear();
+	if(speller){
+		CheckerPrivate::loadReplacements(lang, replacements);
+		// The ignored words apply to any language
+		for(const QString& word : qAsConst(ignoredWords)){
+			speller->addToSession(word);
+			QByteArray utf8 = word.toUtf8();
+			knownWords.insert(utf8.constData(), utf8.size());
+		}
+	}
+
+	for(TextEditChecker* checker : qAsConst(checkers)){
+		TextEditCheckerPrivate* d = checker->d_func();
+		d->setSharedDictionary(lang, speller, verdicts, &replacements, &ignoredWords, &knownWords);
+		d->recheckAll();
+	}
+	return !speller.isNull();
+}
+
+template<class T>
+TextEditChecker* CheckerGroupPrivate::attach(T* textEdit)
+{
+	Q_Q(CheckerGroup);
+	TextEditChecker* checker = checkers.value(textEdit);
+	if(checker || !textEdit){
+		return checker;
+	}
+	checker = new TextEditChecker(this, q);
+	checkers.insert(textEdit, checker);
+	checker->setDecodeLanguageCodes(decodeCodes);
+	checker->setShowCheckSpellingCheckbox(spellingCheckbox);
+	checker->d_func()->spellingEnabled = spellingEnabled;
+	checker->setTextEdit(textEdit);
+	QObject::connect(checker, &Checker::languageChanged, q, &CheckerGroup::languageChanged);
+	QObject::connect(textEdit, &QObject::destroyed, q, [this](QObject* obj){ detach(obj, true); });
+	return checker;
+}
+
+void CheckerGroupPrivate::detach(QObject* textEdit, bool destroyed)
+{
+	Q_Q(CheckerGroup);
+	TextEditChecker* checker = checkers.take(textEdit);
+	if(!checker){
+		return;
+	}
+	// The checker no longer refers to the group, which may be destroyed before the checker
+	TextEditCheckerPrivate* d = checker->d_func();
+	d->group = nullptr;
+	d->replacements = &d->ownReplacements;
+	d->ignoredWords = &d->ownIgnoredWords;
+	d->knownWords = d->ownKnownWords;
+	if(destroyed){
+		// The checker detaches itself from the destroyed text edit, and may still be handling its destruction
+		checker->setParent(nullptr);
+		checker->deleteLater();
+	}else{
+		QObject::disconnect(textEdit, nullptr, q, nullptr);
+		delete checker;
+	}
+}
+
+void CheckerGroupPrivate::setSpellingEnabled(bool enabled)
+{
+	spellingEnabled = enabled;
+	for(TextEditChecker* checker : qAsConst(checkers)){
+		checker->setSpellingEnabled(enabled);
+	}
+}
+
+void CheckerGroupPrivate::clearMisspelledWord(const QString& word)
+{
+	for(TextEditChecker* checker : qAsConst(checkers)){
+		checker->d_func()->clearMisspelledWord(word);
+	}
+}
+
+void CheckerGroupPrivate::recheckAll()
+{
+	for(TextEditChecker* checker : qAsConst(checkers)){
+		checker->d_func()->recheckAll();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+CheckerGroup::CheckerGroup(QObject* parent)
+	: QObject(parent)
+	, d_ptr(new CheckerGroupPrivate(this))
+{
+	Q_D(CheckerGroup);
+	d->setLanguage("");
+}
+
+CheckerGroup::~CheckerGroup()
+{
+	Q_D(CheckerGroup);
+	// The checkers are destroyed first, as they refer to the group
+	while(!d->checkers.isEmpty()){
+		d->detach(d->checkers.begin().key(), false);
+	}
+	delete d_ptr;
+}
+
+TextEditChecker* CheckerGroup::attach(QTextEdit* textEdit)
+{
+	Q_D(CheckerGroup);
+	return d->attach(textEdit);
+}
+
+TextEditChecker* CheckerGroup::attach(QPlainTextEdit* textEdit)
+{
+	Q_D(CheckerGroup);
+	return d->attach(textEdit);
+}
+
+void CheckerGroup::detach(QObject* textEdit)
+{
+	Q_D(CheckerGroup);
+	d->detach(textEdit, false);
+}
+
+QList<TextEditChecker*> CheckerGroup::getCheckers() const
+{
+	Q_D(const CheckerGroup);
+	return d->checkers.values();
+}
+
+bool CheckerGroup::setLanguage(const QString& lang)
+{
+	Q_D(CheckerGroup);
+	return d->setLanguage(lang);
+}
+
+QString CheckerGroup::getLanguage() const
+{
+	Q_D(const CheckerGroup);
+	return d->lang;
+}
+
+void CheckerGroup::setDecodeLanguageCodes(bool decode)
+{
+	Q_D(CheckerGroup);
+	d->decodeCodes = decode;
+	for(TextEditChecker* checker : qAsConst(d->checkers)){
+		checker->setDecodeLanguageCodes(decode);
+	}
+}
+
+void CheckerGroup::setShowCheckSpellingCheckbox(bool show)
+{
+	Q_D(CheckerGroup);
+	d->spellingCheckbox = show;
+	for(TextEditChecker* checker : qAsConst(d->checkers)){
+		checker->setShowCheckSpellingCheckbox(show);
+	}
+}
+
+void CheckerGroup::setSpellingEnabled(bool enabled)
+{
+	Q_D(CheckerGroup);
+	d->setSpellingEnabled(enabled);
+}
+
+} // QtSpell
@@ -0,0 +1,70 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_CHECKERGROUP_P_HPP
+#define QTSPELL_CHECKERGROUP_P_HPP
+
+#include "WordSet.hpp"
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+
+namespace QtSpell {
+
+class CheckerGroup;
+class Dictionary;
+class TextEditChecker;
+
+class CheckerGroupPrivate
+{
+public:
+	CheckerGroupPrivate(CheckerGroup* group);
+
+	bool setLanguage(const QString& newLang);
+	void setSpellingEnabled(bool enabled);
+	template<class T>
+	TextEditChecker* attach(T* textEdit);
+	void detach(QObject* textEdit, bool destroyed);
+	void clearMisspelledWord(const QString& word);
+	void recheckAll();
+
+	CheckerGroup* q_ptr = nullptr;
+	// The dictionary and its verdicts, shared by all checkers of the group
+	QString lang;
+	QSharedPointer<Dictionary> speller;
+	QSharedPointer<QHash<QByteArray, bool>> verdicts;
+	// The replacements of the language, the ignored words and the words known to be correct, loaded and added to
+	// the dictionary once for all checkers of the group
+	QHash<QString, QString> replacements;
+	QSet<QString> ignoredWords;
+	WordSet knownWords;
+	bool decodeCodes = false;
+	bool spellingCheckbox = false;
+	bool spellingEnabled = true;
+	// The checkers by text edit
+	QHash<QObject*, TextEditChecker*> checkers;
+
+	Q_DECLARE_PUBLIC(CheckerGroup)
+};
+
+} // QtSpell
+
+#endif // QTSPELL_CHECKERGROUP_P_HPP
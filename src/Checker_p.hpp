@@ -20,13 +20,23 @@
 #ifndef QTSPELL_CHECKER_P_HPP
 #define QTSPELL_CHECKER_P_HPP
 
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
+#include <QStringView>
 
-namespace enchant { class Dict; }
+class QMenu;
 
 namespace QtSpell {
 
 class Checker;
+class Dictionary;
+class SuggestionIndex;
+class WordIndex;
+class WordSet;
 
 class CheckerPrivate
 {
@@ -35,14 +45,50 @@ public:
 	virtual ~CheckerPrivate();
 
 	void init();
-	bool setLanguageInternal(const QString& newLang);
+	virtual void initLanguage();
+	virtual bool setLanguageInternal(const QString& newLang);
+	void setSharedDictionary(const QString& newLang, const QSharedPointer<Dictionary>& dictionary, const QSharedPointer<QHash<QByteArray, bool>>& sharedVerdicts,
+							 QHash<QString, QString>* sharedReplacements, QSet<QString>* sharedIgnoredWords, WordSet* sharedKnownWords);
+	void resetDictionary();
+	void dictionaryLoaded();
+	virtual void recheckWord(const QString& word, int start, int end);
+	virtual void recheckAll();
+	virtual void recheckAllSharingDictionary();
+	static void loadReplacements(const QString& lang, QHash<QString, QString>& replacements);
+	static void saveReplacements(const QString& lang, const QHash<QString, QString>& replacements);
+	bool checkWord(QStringView word) const;
+	int encodeUtf8(QStringView text) const;
+	void updateLanguagesMenu();
 
 	Checker* q_ptr = nullptr;
-	enchant::Dict* speller = nullptr;
+	QSharedPointer<Dictionary> speller;
+	WordIndex* wordIndex = nullptr;
+	SuggestionIndex* suggestionIndex = nullptr;
 	QString lang;
 	bool decodeCodes = false;
 	bool spellingCheckbox = false;
 	bool spellingEnabled = true;
+	bool autoCorrect = false;
+	bool mergeSuggestions = false;
+	// The replacements chosen by the user for misspelled words of the current language, and the words ignored
+	// by the user, either of the checker or shared by the checkers of a CheckerGroup
+	QHash<QString, QString> ownReplacements;
+	QHash<QString, QString>* replacements = &ownReplacements;
+	QSet<QString> ownIgnoredWords;
+	QSet<QString>* ignoredWords = &ownIgnoredWords;
+	// The words known to be correct because they were ignored or added, either of the checker or shared by the
+	// checkers of a CheckerGroup
+	WordSet* ownKnownWords = nullptr;
+	WordSet* knownWords = nullptr;
+	// The verdicts of the dictionary, when it is shared by the checkers of a CheckerGroup
+	QSharedPointer<QHash<QByteArray, bool>> verdicts;
+	// Reusable buffer holding the UTF-8 encoding of the word passed to the dictionary
+	mutable QByteArray utf8Scratch;
+	// The languages submenu of the context menu, populated when it is first shown and rebuilt only if the
+	// language list or the decode setting changed
+	QMenu* languagesMenu = nullptr;
+	QList<QString> languagesMenuLangs;
+	bool languagesMenuDecoded = false;
 
 	Q_DECLARE_PUBLIC(Checker)
 };
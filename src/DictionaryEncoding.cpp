@@ -0,0 +1,139 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DictionaryEncoding.hpp"
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#ifdef Q_OS_UNIX
+#include <iconv.h>
+#endif
+#else
+#include <QTextCodec>
+#endif
+
+namespace QtSpell {
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+// Converts the input with the iconv conversion, returns an empty array on failure
+static QByteArray iconv_convert(void* conversion, const char* data, int length, int maxRatio)
+{
+	iconv_t cd = static_cast<iconv_t>(conversion);
+	QByteArray output(length * maxRatio + 4, Qt::Uninitialized);
+	char* in = const_cast<char*>(data);
+	size_t inLeft = length;
+	char* out = output.data();
+	size_t outLeft = output.size();
+	iconv(cd, nullptr, nullptr, nullptr, nullptr);
+	if(iconv(cd, &in, &inLeft, &out, &outLeft) == size_t(-1)){
+		return QByteArray();
+	}
+	output.truncate(output.size() - int(outLeft));
+	return output;
+}
+#endif
+
+DictionaryEncoding::~DictionaryEncoding()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+	if(m_toUtf8){
+		iconv_close(static_cast<iconv_t>(m_toUtf8));
+	}
+	if(m_fromUtf8){
+		iconv_close(static_cast<iconv_t>(m_fromUtf8));
+	}
+#endif
+}
+
+bool DictionaryEncoding::setEncoding(const QByteArray& name)
+{
+	m_utf8 = name.isEmpty() || name.toUpper() == "UTF-8";
+	if(m_utf8){
+		return true;
+	}
+	// Hunspell names the ISO 8859 encodings i.e. ISO8859-1
+	QByteArray qtName = name;
+	qtName.replace("ISO8859", "ISO-8859");
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	m_encoder = QStringEncoder(qtName.constData(), QStringConverter::Flag::Stateless);
+	m_decoder = QStringDecoder(qtName.constData(), QStringConverter::Flag::Stateless);
+	if(m_encoder.isValid() && m_decoder.isValid()){
+		return true;
+	}
+#ifdef Q_OS_UNIX
+	// QStringConverter only provides the UTF and Latin-1 encodings
+	iconv_t toUtf8 = iconv_open("UTF-8", qtName.constData());
+	iconv_t fromUtf8 = iconv_open(qtName.constData(), "UTF-8");
+	if(toUtf8 == iconv_t(-1) || fromUtf8 == iconv_t(-1)){
+		if(toUtf8 != iconv_t(-1)){
+			iconv_close(toUtf8);
+		}
+		if(fromUtf8 != iconv_t(-1)){
+			iconv_close(fromUtf8);
+		}
+		return false;
+	}
+	m_toUtf8 = toUtf8;
+	m_fromUtf8 = fromUtf8;
+	return true;
+#else
+	return false;
+#endif
+#else
+	m_codec = QTextCodec::codecForName(qtName);
+	return m_codec != nullptr;
+#endif
+}
+
+QString DictionaryEncoding::decode(const char* data, int length)
+{
+	if(m_utf8){
+		return QString::fromUtf8(data, length);
+	}
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#ifdef Q_OS_UNIX
+	if(m_toUtf8){
+		QMutexLocker locker(&m_iconvMutex);
+		return QString::fromUtf8(iconv_convert(m_toUtf8, data, length, 4));
+	}
+#endif
+	return m_decoder.decode(QByteArrayView(data, length));
+#else
+	return m_codec->toUnicode(data, length);
+#endif
+}
+
+QByteArray DictionaryEncoding::encode(const QString& text)
+{
+	if(m_utf8){
+		return text.toUtf8();
+	}
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#ifdef Q_OS_UNIX
+	if(m_fromUtf8){
+		QMutexLocker locker(&m_iconvMutex);
+		QByteArray utf8 = text.toUtf8();
+		return iconv_convert(m_fromUtf8, utf8.constData(), utf8.size(), 2);
+	}
+#endif
+	return m_encoder.encode(text);
+#else
+	return m_codec->fromUnicode(text);
+#endif
+}
+
+} // QtSpell
@@ -0,0 +1,94 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_DICTIONARYENCODING_HPP
+#define QTSPELL_DICTIONARYENCODING_HPP
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QStringDecoder>
+#include <QStringEncoder>
+#else
+class QTextCodec;
+#endif
+
+namespace QtSpell {
+
+/**
+ * @brief Converts text from and to the encoding of a hunspell dictionary, as
+ *        named by the SET directive of its .aff file.
+ * @note With Qt 6, encodings not built into Qt (i.e. ISO8859-15 or KOI8-R)
+ *       are converted with iconv, which is only available on Unix systems.
+ */
+class DictionaryEncoding
+{
+public:
+	DictionaryEncoding() {}
+	~DictionaryEncoding();
+	DictionaryEncoding(const DictionaryEncoding&) = delete;
+	DictionaryEncoding& operator=(const DictionaryEncoding&) = delete;
+
+	/**
+	 * @brief Sets the encoding.
+	 * @param name The name of the encoding, i.e. "ISO8859-1", or an empty
+	 *        string for UTF-8.
+	 * @return Whether the encoding is supported.
+	 */
+	bool setEncoding(const QByteArray& name);
+
+	/**
+	 * @brief Returns whether the encoding is UTF-8, in which case the text
+	 *        can be passed as it is.
+	 * @return Whether the encoding is UTF-8.
+	 */
+	bool isUtf8() const{ return m_utf8; }
+
+	/**
+	 * @brief Decodes text in the encoding.
+	 * @param data The encoded text.
+	 * @param length The length of the encoded text, in bytes.
+	 * @return The decoded text.
+	 */
+	QString decode(const char* data, int length);
+
+	/**
+	 * @brief Encodes text in the encoding.
+	 * @param text The text to encode.
+	 * @return The encoded text.
+	 */
+	QByteArray encode(const QString& text);
+
+private:
+	bool m_utf8 = true;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	QStringEncoder m_encoder;
+	QStringDecoder m_decoder;
+	// The iconv conversions used for the encodings which Qt doesn't provide, serialized by the mutex
+	void* m_toUtf8 = nullptr;
+	void* m_fromUtf8 = nullptr;
+	QMutex m_iconvMutex;
+#else
+	QTextCodec* m_codec = nullptr;
+#endif
+};
+
+} // QtSpell
+
+#endif // QTSPELL_DICTIONARYENCODING_HPP
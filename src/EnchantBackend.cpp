@@ -0,0 +1,161 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EnchantBackend.hpp"
+#include "PersonalDictionaryWriter.hpp"
+
+#include <enchant.h>
+#include <QtDebug>
+#include <algorithm>
+
+static void dict_describe_cb(const char* const lang_tag,
+							 const char* const /*provider_name*/,
+							 const char* const /*provider_desc*/,
+							 const char* const /*provider_file*/,
+							 void* user_data)
+{
+	QList<QString>* languages = static_cast<QList<QString>*>(user_data);
+	languages->append(lang_tag);
+}
+
+namespace QtSpell {
+
+class EnchantDictionary : public Dictionary
+{
+public:
+	EnchantDictionary(EnchantBackend* backend, EnchantDict* dict, const QString& lang)
+		: m_backend(backend), m_dict(dict), m_lang(lang) {}
+
+	~EnchantDictionary()
+	{
+		QMutexLocker locker(&m_backend->m_mutex);
+		enchant_broker_free_dict(m_backend->m_broker, m_dict);
+	}
+
+	bool check(const char* utf8, int length) override
+	{
+		// Errors are treated as correct words
+		return enchant_dict_check(m_dict, utf8, length) <= 0;
+	}
+
+	QList<QString> suggest(const QString& word) override
+	{
+		QList<QString> list;
+		QByteArray utf8 = word.toUtf8();
+		size_t count = 0;
+		char** suggestions = enchant_dict_suggest(m_dict, utf8.constData(), utf8.size(), &count);
+		for(size_t i = 0; i < count; ++i){
+			list.append(QString::fromUtf8(suggestions[i]));
+		}
+		if(suggestions){
+			enchant_dict_free_string_list(m_dict, suggestions);
+		}
+		return list;
+	}
+
+	void add(const QString& word) override
+	{
+		// The word is known immediately, writing the personal dictionary happens in the background
+		addToSession(word);
+		PersonalDictionaryWriter::instance()->add(m_lang, word);
+	}
+
+	void addToSession(const QString& word) override
+	{
+		QByteArray utf8 = word.toUtf8();
+		enchant_dict_add_to_session(m_dict, utf8.constData(), utf8.size());
+	}
+
+	void removeFromSession(const QString& word) override
+	{
+		QByteArray utf8 = word.toUtf8();
+		enchant_dict_remove_from_session(m_dict, utf8.constData(), utf8.size());
+	}
+
+	void storeReplacement(const QString& misspelling, const QString& replacement) override
+	{
+		QByteArray misspellingUtf8 = misspelling.toUtf8();
+		QByteArray replacementUtf8 = replacement.toUtf8();
+		enchant_dict_store_replacement(m_dict, misspellingUtf8.constData(), misspellingUtf8.size(), replacementUtf8.constData(), replacementUtf8.size());
+	}
+
+private:
+	EnchantBackend* m_backend;
+	EnchantDict* m_dict;
+	QString m_lang;
+};
+
+EnchantBackend::EnchantBackend()
+	: m_broker(enchant_broker_init())
+{
+}
+
+EnchantBackend::~EnchantBackend()
+{
+	for(EnchantDict* dict : qAsConst(m_preloaded)){
+		enchant_broker_free_dict(m_broker, dict);
+	}
+	enchant_broker_free(m_broker);
+}
+
+QList<QString> EnchantBackend::listLanguages()
+{
+	QMutexLocker locker(&m_mutex);
+	QList<QString> languages;
+	enchant_broker_list_dicts(m_broker, dict_describe_cb, &languages);
+	std::sort(languages.begin(), languages.end());
+	return languages;
+}
+
+bool EnchantBackend::hasLanguage(const QString& lang)
+{
+	QMutexLocker locker(&m_mutex);
+	return enchant_broker_dict_exists(m_broker, lang.toUtf8().constData()) != 0;
+}
+
+Dictionary* EnchantBackend::requestDictionary(const QString& lang)
+{
+	EnchantDict* dict = nullptr;
+	{
+		QMutexLocker locker(&m_mutex);
+		dict = enchant_broker_request_dict(m_broker, lang.toUtf8().constData());
+		if(!dict){
+			qWarning() << "Failed to load dictionary: " << enchant_broker_get_error(m_broker);
+			return nullptr;
+		}
+	}
+	// Words added before a crash may not have reached the personal dictionary
+	PersonalDictionaryWriter::recover(lang);
+	return new EnchantDictionary(this, dict, lang);
+}
+
+void EnchantBackend::preload(const QString& lang)
+{
+	QMutexLocker locker(&m_mutex);
+	if(m_preloaded.contains(lang)){
+		return;
+	}
+	EnchantDict* dict = enchant_broker_request_dict(m_broker, lang.toUtf8().constData());
+	if(dict){
+		m_preloaded.insert(lang, dict);
+	}else{
+		qWarning() << "Failed to preload dictionary: " << enchant_broker_get_error(m_broker);
+	}
+}
+
+} // QtSpell
@@ -0,0 +1,60 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_ENCHANTBACKEND_HPP
+#define QTSPELL_ENCHANTBACKEND_HPP
+
+#include "QtSpell.hpp"
+
+#include <QMap>
+#include <QMutex>
+
+typedef struct str_enchant_broker EnchantBroker;
+typedef struct str_enchant_dict EnchantDict;
+
+namespace QtSpell {
+
+/**
+ * @brief Backend using the dictionaries provided by enchant. Words added to
+ *        the user dictionary are written in the background by the
+ *        PersonalDictionaryWriter.
+ */
+class EnchantBackend : public Backend
+{
+public:
+	EnchantBackend();
+	~EnchantBackend();
+
+	QList<QString> listLanguages() override;
+	bool hasLanguage(const QString& lang) override;
+	Dictionary* requestDictionary(const QString& lang) override;
+	void preload(const QString& lang) override;
+
+private:
+	friend class EnchantDictionary;
+
+	EnchantBroker* m_broker;
+	// Serializes the use of the broker, which is also used by the thread preloading dictionaries
+	QMutex m_mutex;
+	// The preloaded dictionaries, kept open so that the broker serves later requests from its cache
+	QMap<QString, EnchantDict*> m_preloaded;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_ENCHANTBACKEND_HPP
@@ -0,0 +1,208 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HunspellBackend.hpp"
+#include "DictionaryEncoding.hpp"
+#include "PersonalDictionaryWriter.hpp"
+
+#include <hunspell.hxx>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtDebug>
+#include <algorithm>
+#include <memory>
+
+namespace QtSpell {
+
+static QString personalWordListPath(const QString& lang)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/qtspell/hunspell/" + lang + ".dic";
+}
+
+// A loaded hunspell dictionary, along with the conversion from and to its encoding
+class HunspellData
+{
+public:
+	std::unique_ptr<Hunspell> hunspell;
+	DictionaryEncoding encoding;
+
+	std::string encode(const QString& word)
+	{
+		QByteArray encoded = encoding.encode(word);
+		return std::string(encoded.constData(), encoded.size());
+	}
+
+	QString decode(const std::string& word)
+	{
+		return encoding.decode(word.data(), int(word.size()));
+	}
+};
+
+class HunspellDictionary : public Dictionary
+{
+public:
+	HunspellDictionary(const QSharedPointer<HunspellData>& data, const QString& lang)
+		: m_data(data), m_lang(lang) {}
+
+	bool check(const char* utf8, int length) override
+	{
+		if(!m_session.isEmpty() && m_session.contains(QByteArray::fromRawData(utf8, length))){
+			return true;
+		}
+		// Hunspell takes a std::string, which is reused so that long words don't allocate
+		if(m_data->encoding.isUtf8()){
+			m_scratch.assign(utf8, length);
+			return m_data->hunspell->spell(m_scratch);
+		}
+		return m_data->hunspell->spell(m_data->encode(QString::fromUtf8(utf8, length)));
+	}
+
+	QList<QString> suggest(const QString& word) override
+	{
+		QList<QString> list;
+		for(const std::string& suggestion : m_data->hunspell->suggest(m_data->encode(word))){
+			list.append(m_data->decode(suggestion));
+		}
+		return list;
+	}
+
+	void add(const QString& word) override
+	{
+		m_data->hunspell->add(m_data->encode(word));
+		// Hunspell has no personal dictionary, appending the word to our own keeps it for the next session
+		PersonalDictionaryWriter::instance()->addToWordList(personalWordListPath(m_lang), word);
+	}
+
+	void addToSession(const QString& word) override
+	{
+		m_session.insert(word.toUtf8());
+	}
+
+	void removeFromSession(const QString& word) override
+	{
+		m_session.remove(word.toUtf8());
+	}
+
+private:
+	QSharedPointer<HunspellData> m_data;
+	QString m_lang;
+	QSet<QByteArray> m_session;
+	std::string m_scratch;
+};
+
+HunspellBackend::HunspellBackend(const QList<QString>& searchPaths)
+	: m_searchPaths(searchPaths)
+{
+	if(m_searchPaths.isEmpty()){
+		for(const QString& path : QString::fromLocal8Bit(qgetenv("DICPATH")).split(QDir::listSeparator())){
+			if(!path.isEmpty()){
+				m_searchPaths.append(path);
+			}
+		}
+		for(const QString& path : QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, "hunspell", QStandardPaths::LocateDirectory)){
+			m_searchPaths.append(path);
+		}
+		m_searchPaths.append("/usr/share/hunspell");
+		m_searchPaths.append("/usr/share/myspell");
+		m_searchPaths.append("/usr/share/myspell/dicts");
+	}
+}
+
+QList<QString> HunspellBackend::listLanguages()
+{
+	QSet<QString> languages;
+	for(const QString& path : qAsConst(m_searchPaths)){
+		QDir dir(path);
+		for(const QFileInfo& aff : dir.entryInfoList(QStringList() << "*.aff", QDir::Files)){
+			if(dir.exists(aff.completeBaseName() + ".dic")){
+				languages.insert(aff.completeBaseName());
+			}
+		}
+	}
+	QList<QString> list = languages.values();
+	std::sort(list.begin(), list.end());
+	return list;
+}
+
+bool HunspellBackend::hasLanguage(const QString& lang)
+{
+	return !dictionaryPath(lang).isEmpty();
+}
+
+Dictionary* HunspellBackend::requestDictionary(const QString& lang)
+{
+	QSharedPointer<HunspellData> data = load(lang);
+	return data ? new HunspellDictionary(data, lang) : nullptr;
+}
+
+void HunspellBackend::preload(const QString& lang)
+{
+	QSharedPointer<HunspellData> data = load(lang);
+	if(data){
+		QMutexLocker locker(&m_mutex);
+		m_preloaded.insert(lang, data);
+	}
+}
+
+QString HunspellBackend::dictionaryPath(const QString& lang) const
+{
+	for(const QString& path : m_searchPaths){
+		QString base = QDir(path).filePath(lang);
+		if(QFile::exists(base + ".aff") && QFile::exists(base + ".dic")){
+			return base;
+		}
+	}
+	return QString();
+}
+
+QSharedPointer<HunspellData> HunspellBackend::load(const QString& lang)
+{
+	QMutexLocker locker(&m_mutex);
+	QSharedPointer<HunspellData> data = m_loaded.value(lang).toStrongRef();
+	if(data){
+		return data;
+	}
+	QString base = dictionaryPath(lang);
+	if(base.isEmpty()){
+		qWarning() << "Failed to load dictionary: no hunspell dictionary for " << lang;
+		return data;
+	}
+	data.reset(new HunspellData());
+	data->hunspell.reset(new Hunspell(QFile::encodeName(base + ".aff").constData(), QFile::encodeName(base + ".dic").constData()));
+	if(!data->encoding.setEncoding(QByteArray(data->hunspell->get_dict_encoding().c_str()))){
+		qWarning() << "Failed to load dictionary: unsupported encoding " << data->hunspell->get_dict_encoding().c_str();
+		return QSharedPointer<HunspellData>();
+	}
+	QFile personal(personalWordListPath(lang));
+	if(personal.open(QIODevice::ReadOnly)){
+		while(!personal.atEnd()){
+			QString word = QString::fromUtf8(personal.readLine().trimmed());
+			if(!word.isEmpty()){
+				data->hunspell->add(data->encode(word));
+			}
+		}
+	}
+	m_loaded.insert(lang, data);
+	return data;
+}
+
+} // QtSpell
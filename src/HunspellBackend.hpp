@@ -0,0 +1,77 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_HUNSPELLBACKEND_HPP
+#define QTSPELL_HUNSPELLBACKEND_HPP
+
+#include "QtSpell.hpp"
+
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+class Hunspell;
+
+namespace QtSpell {
+
+class HunspellData;
+
+/**
+ * @brief Backend calling hunspell directly, without going through the
+ *        enchant providers. The dictionaries are looked up as pairs of .aff
+ *        and .dic files in the search paths, and each is loaded only once
+ *        and shared by all dictionaries of its language. Preloaded
+ *        languages stay loaded for the lifetime of the backend, the others
+ *        are freed once none of their dictionaries is left.
+ * @note With Qt 6, dictionaries in encodings not built into Qt are only
+ *       supported on Unix systems, where they are converted with iconv.
+ *       Added words are written to the personal word list by the
+ *       PersonalDictionaryWriter thread.
+ */
+class HunspellBackend : public Backend
+{
+public:
+	/**
+	 * @brief HunspellBackend constructor.
+	 * @param searchPaths The directories containing the dictionaries, or an
+	 *        empty list for the directories in DICPATH and the usual system
+	 *        directories.
+	 */
+	HunspellBackend(const QList<QString>& searchPaths);
+
+	QList<QString> listLanguages() override;
+	bool hasLanguage(const QString& lang) override;
+	Dictionary* requestDictionary(const QString& lang) override;
+	void preload(const QString& lang) override;
+
+private:
+	QList<QString> m_searchPaths;
+	// Serializes loading dictionaries, which also happens in the thread preloading dictionaries
+	QMutex m_mutex;
+	// The loaded dictionaries, which are freed along with their last dictionary, except for the preloaded ones
+	QMap<QString, QWeakPointer<HunspellData>> m_loaded;
+	QMap<QString, QSharedPointer<HunspellData>> m_preloaded;
+
+	QString dictionaryPath(const QString& lang) const;
+	QSharedPointer<HunspellData> load(const QString& lang);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_HUNSPELLBACKEND_HPP
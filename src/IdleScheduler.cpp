@@ -0,0 +1,158 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "IdleScheduler.hpp"
+#include "TextEditChecker_p.hpp"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QPair>
+#include <QPointer>
+#include <QVector>
+#include <QWidget>
+#include <algorithm>
+
+namespace QtSpell {
+
+// Maximum time in ms the background checks may block the event loop per iteration
+static const int FrameBudget = 4;
+// The budget, and the delay in ms between iterations, while there is input pressure
+static const int InputPressureBudget = 1;
+static const int InputPressureInterval = 16;
+// Input events less than this many ms ago count as input pressure
+static const int InputPressureWindow = 100;
+
+static QPointer<IdleScheduler>& scheduler_instance()
+{
+	static QPointer<IdleScheduler> scheduler;
+	return scheduler;
+}
+
+IdleScheduler* IdleScheduler::instance()
+{
+	QPointer<IdleScheduler>& scheduler = scheduler_instance();
+	if(!scheduler){
+		// Owned by the application, so that the timer doesn't outlive the event loop
+		scheduler = new IdleScheduler(QCoreApplication::instance());
+	}
+	return scheduler;
+}
+
+IdleScheduler::IdleScheduler(QObject* parent)
+	: QObject(parent)
+{
+	m_timer.setSingleShot(true);
+	connect(&m_timer, &QTimer::timeout, this, &IdleScheduler::processQueue);
+}
+
+void IdleScheduler::schedule(TextEditCheckerPrivate* checker)
+{
+	if(!m_queue.contains(checker)){
+		m_queue.append(checker);
+	}
+	if(!m_timer.isActive()){
+		setWatchingInput(true);
+		m_timer.start(0);
+	}
+}
+
+void IdleScheduler::cancel(TextEditCheckerPrivate* checker)
+{
+	IdleScheduler* scheduler = scheduler_instance();
+	if(scheduler && scheduler->m_queue.removeOne(checker) && scheduler->m_queue.isEmpty()){
+		scheduler->m_timer.stop();
+		scheduler->setWatchingInput(false);
+	}
+}
+
+bool IdleScheduler::eventFilter(QObject* obj, QEvent* event)
+{
+	switch(event->type()){
+	case QEvent::KeyPress:
+	case QEvent::MouseButtonPress:
+	case QEvent::MouseButtonDblClick:
+	case QEvent::Wheel:
+	case QEvent::InputMethod:
+	case QEvent::TouchBegin:
+	case QEvent::TouchUpdate:
+		m_lastInput.start();
+		break;
+	default:
+		break;
+	}
+	return QObject::eventFilter(obj, event);
+}
+
+void IdleScheduler::setWatchingInput(bool watch)
+{
+	if(QCoreApplication::instance() == nullptr){
+		return;
+	}
+	if(watch){
+		QCoreApplication::instance()->installEventFilter(this);
+	}else{
+		QCoreApplication::instance()->removeEventFilter(this);
+		m_lastInput.invalidate();
+	}
+}
+
+int IdleScheduler::priority(const TextEditCheckerPrivate* checker)
+{
+	QWidget* widget = checker->textEdit ? checker->textEdit->widget() : nullptr;
+	if(!widget){
+		return 0;
+	}
+	if(widget->hasFocus()){
+		return 2;
+	}
+	return widget->isVisible() && !widget->visibleRegion().isEmpty() ? 1 : 0;
+}
+
+void IdleScheduler::processQueue()
+{
+	bool inputPressure = m_lastInput.isValid() && m_lastInput.elapsed() < InputPressureWindow;
+	int budget = inputPressure ? InputPressureBudget : FrameBudget;
+
+	// The focused text edit first, then the visible ones, the others in round-robin order
+	QVector<QPair<int, TextEditCheckerPrivate*>> ordered;
+	ordered.reserve(m_queue.size());
+	for(TextEditCheckerPrivate* checker : qAsConst(m_queue)){
+		ordered.append(qMakePair(priority(checker), checker));
+	}
+	std::stable_sort(ordered.begin(), ordered.end(), [](const QPair<int, TextEditCheckerPrivate*>& a, const QPair<int, TextEditCheckerPrivate*>& b){ return a.first > b.first; });
+	m_queue.clear();
+	for(const auto& entry : qAsConst(ordered)){
+		m_queue.append(entry.second);
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	while(!m_queue.isEmpty() && timer.elapsed() < budget){
+		TextEditCheckerPrivate* checker = m_queue.takeFirst();
+		if(checker->runBackgroundCheck(budget - int(timer.elapsed()))){
+			m_queue.append(checker);
+		}
+	}
+	if(m_queue.isEmpty()){
+		setWatchingInput(false);
+	}else{
+		m_timer.start(inputPressure ? InputPressureInterval : 0);
+	}
+}
+
+} // QtSpell
@@ -0,0 +1,76 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_IDLESCHEDULER_HPP
+#define QTSPELL_IDLESCHEDULER_HPP
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+namespace QtSpell {
+
+class TextEditCheckerPrivate;
+
+/**
+ * @brief Runs the background checks of all checkers of the process, within a
+ *        fixed time budget per event loop iteration. The check of the focused
+ *        text edit runs first, then those of the visible text edits, and the
+ *        budget is reduced while the user is typing or clicking.
+ */
+class IdleScheduler : public QObject
+{
+public:
+	/**
+	 * @brief Get scheduler instance, owned by the application.
+	 * @return The scheduler singleton
+	 */
+	static IdleScheduler* instance();
+
+	/**
+	 * @brief Queues the background check of a checker, if not already queued.
+	 * @param checker The checker whose pending range is to be checked.
+	 */
+	void schedule(TextEditCheckerPrivate* checker);
+
+	/**
+	 * @brief Removes a checker from the queue. Does not create the scheduler
+	 *        if it does not exist.
+	 * @param checker The checker to remove.
+	 */
+	static void cancel(TextEditCheckerPrivate* checker);
+
+protected:
+	bool eventFilter(QObject* obj, QEvent* event) override;
+
+private:
+	QList<TextEditCheckerPrivate*> m_queue;
+	QTimer m_timer;
+	// The time since the last input event, only tracked while checks are queued
+	QElapsedTimer m_lastInput;
+
+	IdleScheduler(QObject* parent);
+	void processQueue();
+	void setWatchingInput(bool watch);
+	static int priority(const TextEditCheckerPrivate* checker);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_IDLESCHEDULER_HPP
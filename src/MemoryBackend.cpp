@@ -0,0 +1,148 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MemoryBackend.hpp"
+#include "SuggestionIndex.hpp"
+
+#include <QPair>
+#include <QtDebug>
+#include <algorithm>
+
+namespace QtSpell {
+
+// Maximum edit distance of suggestions
+static const int MaxSuggestionDistance = 2;
+
+void MemoryBackend::Language::insert(const QString& word)
+{
+	QByteArray utf8 = word.toUtf8();
+	if(!word.isEmpty() && !words.contains(utf8)){
+		words.insert(utf8);
+		list.append(word);
+	}
+}
+
+class MemoryDictionary : public Dictionary
+{
+public:
+	MemoryDictionary(MemoryBackend* backend, const QString& lang, const MemoryBackend::Language& language)
+		: m_backend(backend), m_lang(lang), m_language(language) {}
+
+	bool check(const char* utf8, int length) override
+	{
+		if(contains(utf8, length)){
+			return true;
+		}
+		// Like the usual dictionaries, accept capitalized and upper case forms of lower case words
+		QString word = QString::fromUtf8(utf8, length);
+		if(word.isEmpty() || !word[0].isUpper()){
+			return false;
+		}
+		QByteArray lower = word.toLower().toUtf8();
+		if(word == word.toUpper() && contains(lower.constData(), lower.size())){
+			return true;
+		}
+		QByteArray uncapitalized = (word.left(1).toLower() + word.mid(1)).toUtf8();
+		return contains(uncapitalized.constData(), uncapitalized.size());
+	}
+
+	QList<QString> suggest(const QString& word) override
+	{
+		QList<QPair<int, QString>> candidates;
+		for(const QString& candidate : qAsConst(m_language.list)){
+			int distance = SuggestionIndex::editDistance(word.constData(), word.length(), candidate.constData(), candidate.length(), MaxSuggestionDistance);
+			if(distance > 0 && distance <= MaxSuggestionDistance){
+				candidates.append(qMakePair(distance, candidate));
+			}
+		}
+		std::stable_sort(candidates.begin(), candidates.end(), [](const QPair<int, QString>& a, const QPair<int, QString>& b){
+			return a.first < b.first;
+		});
+		QList<QString> list;
+		for(const QPair<int, QString>& candidate : qAsConst(candidates)){
+			list.append(candidate.second);
+		}
+		return list;
+	}
+
+	void add(const QString& word) override
+	{
+		m_language.insert(word);
+		// Dictionaries requested later know the word as well
+		QMutexLocker locker(&m_backend->m_mutex);
+		m_backend->m_languages[m_lang].insert(word);
+	}
+
+	void addToSession(const QString& word) override
+	{
+		m_session.insert(word.toUtf8());
+	}
+
+	void removeFromSession(const QString& word) override
+	{
+		m_session.remove(word.toUtf8());
+	}
+
+private:
+	MemoryBackend* m_backend;
+	QString m_lang;
+	MemoryBackend::Language m_language;
+	QSet<QByteArray> m_session;
+
+	bool contains(const char* utf8, int length) const
+	{
+		QByteArray word = QByteArray::fromRawData(utf8, length);
+		return m_language.words.contains(word) || m_session.contains(word);
+	}
+};
+
+MemoryBackend::MemoryBackend(const QMap<QString, QList<QString>>& wordLists)
+{
+	for(auto it = wordLists.cbegin(), itEnd = wordLists.cend(); it != itEnd; ++it){
+		Language& language = m_languages[it.key()];
+		for(const QString& word : it.value()){
+			language.insert(word);
+		}
+	}
+}
+
+QList<QString> MemoryBackend::listLanguages()
+{
+	QMutexLocker locker(&m_mutex);
+	return m_languages.keys();
+}
+
+bool MemoryBackend::hasLanguage(const QString& lang)
+{
+	QMutexLocker locker(&m_mutex);
+	return m_languages.contains(lang);
+}
+
+Dictionary* MemoryBackend::requestDictionary(const QString& lang)
+{
+	QMutexLocker locker(&m_mutex);
+	auto it = m_languages.constFind(lang);
+	if(it == m_languages.constEnd()){
+		qWarning() << "Failed to load dictionary: no word list for " << lang;
+		return nullptr;
+	}
+	// The word list is implicitly shared until words are added
+	return new MemoryDictionary(this, lang, it.value());
+}
+
+} // QtSpell
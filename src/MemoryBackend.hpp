@@ -0,0 +1,62 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_MEMORYBACKEND_HPP
+#define QTSPELL_MEMORYBACKEND_HPP
+
+#include "QtSpell.hpp"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QSet>
+
+namespace QtSpell {
+
+/**
+ * @brief Backend serving dictionaries from word lists held in memory, see
+ *        Backend::createMemoryBackend().
+ */
+class MemoryBackend : public Backend
+{
+public:
+	MemoryBackend(const QMap<QString, QList<QString>>& wordLists);
+
+	QList<QString> listLanguages() override;
+	bool hasLanguage(const QString& lang) override;
+	Dictionary* requestDictionary(const QString& lang) override;
+
+private:
+	friend class MemoryDictionary;
+
+	struct Language {
+		// The words in their original order, which ranks suggestions with the same distance
+		QList<QString> list;
+		// The UTF-8 encoded words, for checking
+		QSet<QByteArray> words;
+
+		void insert(const QString& word);
+	};
+
+	// Guards the languages, to which words are added by the dictionaries
+	QMutex m_mutex;
+	QMap<QString, Language> m_languages;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_MEMORYBACKEND_HPP
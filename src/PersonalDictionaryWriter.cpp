@@ -0,0 +1,303 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PersonalDictionaryWriter.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QMap>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+#include <enchant.h>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace QtSpell {
+
+PersonalDictionaryWriter* PersonalDictionaryWriter::instance()
+{
+	static PersonalDictionaryWriter writer;
+	return &writer;
+}
+
+PersonalDictionaryWriter::PersonalDictionaryWriter()
+{
+	start(QThread::LowPriority);
+}
+
+PersonalDictionaryWriter::~PersonalDictionaryWriter()
+{
+	// Write the queued words before exiting
+	{
+		QMutexLocker locker(&m_mutex);
+		m_quit = true;
+		m_queueChanged.wakeAll();
+	}
+	wait();
+}
+
+void PersonalDictionaryWriter::add(const QString& lang, const QString& word)
+{
+	QMutexLocker locker(&m_mutex);
+	m_queue.append(Entry{lang, word, false, QString()});
+	m_queueChanged.wakeAll();
+}
+
+void PersonalDictionaryWriter::addToWordList(const QString& path, const QString& word)
+{
+	QMutexLocker locker(&m_mutex);
+	m_queue.append(Entry{QString(), word, false, path});
+	m_queueChanged.wakeAll();
+}
+
+void PersonalDictionaryWriter::replaceFile(const QString& path, const QByteArray& contents)
+{
+	QMutexLocker locker(&m_mutex);
+	m_files.insert(path, contents);
+	m_queueChanged.wakeAll();
+}
+
+void PersonalDictionaryWriter::recover(const QString& lang)
+{
+	// The journal is only recovered once per language, and read by the thread rather than by the caller
+	PersonalDictionaryWriter* writer = instance();
+	QMutexLocker locker(&writer->m_mutex);
+	if(writer->m_recovered.contains(lang)){
+		return;
+	}
+	writer->m_recovered.insert(lang);
+	writer->m_recoveries.append(lang);
+	writer->m_queueChanged.wakeAll();
+}
+
+QList<QString> PersonalDictionaryWriter::readJournal(const QString& lang)
+{
+	QString path = journalPath(lang);
+	QLockFile lock(path + ".lock");
+	if(!lock.lock()){
+		qWarning() << "Failed to lock dictionary journal: " << path;
+		return QList<QString>();
+	}
+	QList<QString> words;
+	QFile journal(path);
+	if(journal.open(QIODevice::ReadOnly)){
+		while(!journal.atEnd()){
+			QString word = QString::fromUtf8(journal.readLine().trimmed());
+			if(!word.isEmpty()){
+				words.append(word);
+			}
+		}
+	}
+	return words;
+}
+
+QString PersonalDictionaryWriter::journalPath(const QString& lang)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/qtspell/journal/" + lang + ".txt";
+}
+
+bool PersonalDictionaryWriter::appendToJournal(const QString& lang, const QList<QByteArray>& words)
+{
+	QString path = journalPath(lang);
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	// The journal is shared with the other processes, which may be appending to or rewriting it
+	QLockFile lock(path + ".lock");
+	if(!lock.lock()){
+		qWarning() << "Failed to lock dictionary journal: " << path;
+		return false;
+	}
+	QFile journal(path);
+	if(!journal.open(QIODevice::WriteOnly | QIODevice::Append)){
+		qWarning() << "Failed to open dictionary journal: " << journal.errorString();
+		return false;
+	}
+	for(const QByteArray& word : words){
+		journal.write(word + '\n');
+	}
+	journal.flush();
+#ifdef Q_OS_WIN
+	_commit(journal.handle());
+#else
+	fsync(journal.handle());
+#endif
+	return true;
+}
+
+void PersonalDictionaryWriter::removeFromJournal(const QString& lang, const QList<QByteArray>& words)
+{
+	QString path = journalPath(lang);
+	QLockFile lock(path + ".lock");
+	if(!lock.lock()){
+		qWarning() << "Failed to lock dictionary journal: " << path;
+		return;
+	}
+	QFile journal(path);
+	if(!journal.open(QIODevice::ReadOnly)){
+		return;
+	}
+	// Remove one entry per written word, entries appended meanwhile by others are kept
+	QMap<QByteArray, int> written;
+	for(const QByteArray& word : words){
+		++written[word];
+	}
+	QList<QByteArray> remaining;
+	while(!journal.atEnd()){
+		QByteArray word = journal.readLine().trimmed();
+		if(word.isEmpty()){
+			continue;
+		}
+		auto it = written.find(word);
+		if(it != written.end() && it.value() > 0){
+			--it.value();
+		}else{
+			remaining.append(word);
+		}
+	}
+	journal.close();
+	if(remaining.isEmpty()){
+		QFile::remove(path);
+		return;
+	}
+	// Written to a temporary file which replaces the journal, so that the journal is never left half written
+	QSaveFile rewritten(path);
+	if(!rewritten.open(QIODevice::WriteOnly)){
+		qWarning() << "Failed to rewrite dictionary journal: " << rewritten.errorString();
+		return;
+	}
+	for(const QByteArray& word : qAsConst(remaining)){
+		rewritten.write(word + '\n');
+	}
+	if(!rewritten.commit()){
+		qWarning() << "Failed to rewrite dictionary journal: " << rewritten.errorString();
+	}
+}
+
+void PersonalDictionaryWriter::appendToWordList(const QString& path, const QList<QByteArray>& words)
+{
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	QFile file(path);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Append)){
+		qWarning() << "Failed to add word to personal dictionary: " << file.errorString();
+		return;
+	}
+	for(const QByteArray& word : words){
+		file.write(word + '\n');
+	}
+	file.flush();
+#ifdef Q_OS_WIN
+	_commit(file.handle());
+#else
+	fsync(file.handle());
+#endif
+}
+
+void PersonalDictionaryWriter::writeFile(const QString& path, const QByteArray& contents)
+{
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	QSaveFile file(path);
+	if(!file.open(QIODevice::WriteOnly)){
+		qWarning() << "Failed to write file: " << file.errorString();
+		return;
+	}
+	file.write(contents);
+	if(!file.commit()){
+		qWarning() << "Failed to write file: " << file.errorString();
+	}
+}
+
+void PersonalDictionaryWriter::run()
+{
+	// The thread uses its own broker, so that the dictionaries used for checking are not accessed concurrently
+	EnchantBroker* broker = enchant_broker_init();
+	forever {
+		QList<Entry> batch;
+		QList<QString> recoveries;
+		QMap<QString, QByteArray> files;
+		{
+			QMutexLocker locker(&m_mutex);
+			while(m_queue.isEmpty() && m_recoveries.isEmpty() && m_files.isEmpty() && !m_quit){
+				m_queueChanged.wait(&m_mutex);
+			}
+			if(m_queue.isEmpty() && m_recoveries.isEmpty() && m_files.isEmpty()){
+				break;
+			}
+			batch.swap(m_queue);
+			recoveries.swap(m_recoveries);
+			files.swap(m_files);
+		}
+		for(auto it = files.cbegin(), itEnd = files.cend(); it != itEnd; ++it){
+			writeFile(it.key(), it.value());
+		}
+		// The recovered words are already journaled and are not journaled again
+		for(const QString& lang : qAsConst(recoveries)){
+			for(const QString& word : readJournal(lang)){
+				batch.append(Entry{lang, word, true, QString()});
+			}
+		}
+		QMap<QString, QList<QByteArray>> batchWords;
+		QMap<QString, QList<QByteArray>> unjournaled;
+		QMap<QString, QList<QByteArray>> wordListWords;
+		for(const Entry& entry : batch){
+			if(!entry.wordList.isEmpty()){
+				wordListWords[entry.wordList].append(entry.word.toUtf8());
+				continue;
+			}
+			batchWords[entry.lang].append(entry.word.toUtf8());
+			if(!entry.journaled){
+				unjournaled[entry.lang].append(entry.word.toUtf8());
+			}
+		}
+		for(auto it = wordListWords.cbegin(), itEnd = wordListWords.cend(); it != itEnd; ++it){
+			appendToWordList(it.key(), it.value());
+		}
+		for(auto it = batchWords.cbegin(), itEnd = batchWords.cend(); it != itEnd; ++it){
+			const QString& lang = it.key();
+			// Journal the words and sync them to disk before touching the personal dictionary
+			bool journaled = true;
+			if(unjournaled.contains(lang)){
+				journaled = appendToJournal(lang, unjournaled.value(lang));
+			}
+			// Words are added rarely, so the dictionary is only loaded for the batch rather than kept resident next
+			// to the one used for checking
+			EnchantDict* dict = enchant_broker_request_dict(broker, lang.toUtf8().constData());
+			if(!dict){
+				// The words stay in the journal and are recovered the next time the language is used
+				qWarning() << "Failed to load dictionary: " << enchant_broker_get_error(broker);
+				continue;
+			}
+			for(const QByteArray& word : it.value()){
+				// Recovered words may have been added already
+				if(enchant_dict_check(dict, word.constData(), word.size()) != 0){
+					enchant_dict_add(dict, word.constData(), word.size());
+				}
+			}
+			enchant_broker_free_dict(broker, dict);
+			if(journaled){
+				removeFromJournal(lang, it.value());
+			}
+		}
+	}
+	enchant_broker_free(broker);
+}
+
+} // QtSpell
@@ -0,0 +1,118 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_PERSONALDICTIONARYWRITER_HPP
+#define QTSPELL_PERSONALDICTIONARYWRITER_HPP
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace QtSpell {
+
+/**
+ * @brief Background thread adding words to the personal dictionaries. The
+ *        words are first written to a journal, so that words not yet added
+ *        when the application crashed can be recovered.
+ */
+class PersonalDictionaryWriter : public QThread
+{
+public:
+	/**
+	 * @brief Get writer instance, starting its thread if necessary.
+	 * @return The writer singleton
+	 */
+	static PersonalDictionaryWriter* instance();
+
+	~PersonalDictionaryWriter();
+
+	/**
+	 * @brief Queues a word to be added to the personal dictionary.
+	 * @param lang The language of the personal dictionary.
+	 * @param word The word to add.
+	 */
+	void add(const QString& lang, const QString& word);
+
+	/**
+	 * @brief Queues a word to be appended to a word list file, one word per
+	 *        line, for backends without a personal dictionary of their own.
+	 *        The words are not journaled, appending them is the write.
+	 * @param path The path of the word list.
+	 * @param word The word to add.
+	 */
+	void addToWordList(const QString& path, const QString& word);
+
+	/**
+	 * @brief Queues a file to be replaced with the specified contents. If
+	 *        the file is queued again before it is written, only the last
+	 *        contents are written.
+	 * @param path The path of the file.
+	 * @param contents The new contents of the file.
+	 */
+	void replaceFile(const QString& path, const QByteArray& contents);
+
+	/**
+	 * @brief Queues the words which were journaled, but possibly not added
+	 *        to the personal dictionary, to be added again. The journal is
+	 *        read by the writer thread, and only on the first call for a
+	 *        language. The dictionaries pick up the words once they are
+	 *        written to the personal dictionary.
+	 * @param lang The language of the personal dictionary.
+	 */
+	static void recover(const QString& lang);
+
+protected:
+	void run() override;
+
+private:
+	struct Entry {
+		QString lang;
+		QString word;
+		// Whether the word is already in the journal, i.e. it was recovered from it
+		bool journaled;
+		// The word list the word is appended to, or empty for the enchant personal dictionary of lang
+		QString wordList;
+	};
+
+	QMutex m_mutex;
+	QWaitCondition m_queueChanged;
+	QList<Entry> m_queue;
+	// The languages whose journal was recovered, and those whose journal is still to be read, see recover()
+	QSet<QString> m_recovered;
+	QList<QString> m_recoveries;
+	// The files to replace, with their new contents, see replaceFile()
+	QMap<QString, QByteArray> m_files;
+	bool m_quit = false;
+
+	PersonalDictionaryWriter();
+	static QString journalPath(const QString& lang);
+	static QList<QString> readJournal(const QString& lang);
+	static bool appendToJournal(const QString& lang, const QList<QByteArray>& words);
+	static void removeFromJournal(const QString& lang, const QList<QByteArray>& words);
+	static void appendToWordList(const QString& path, const QList<QByteArray>& words);
+	static void writeFile(const QString& path, const QByteArray& contents);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_PERSONALDICTIONARYWRITER_HPP
@@ -21,7 +21,10 @@
 
 #include "QtSpellExport.hpp"
 
+#include <QList>
+#include <QMap>
 #include <QObject>
+#include <QString>
 
 class QMenu;
 class QPlainTextEdit;
@@ -33,6 +36,7 @@ class QTextEdit;
  */
 namespace QtSpell {
 
+class CheckerGroupPrivate;
 class CheckerPrivate;
 class TextEditCheckerPrivate;
 
@@ -43,6 +47,151 @@ bool QTSPELL_API checkLanguageInstalled(const QString& lang);
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief The dictionary of a spell checking backend for one language.
+ * @note A dictionary is only used by one thread at a time.
+ */
+class QTSPELL_API Dictionary
+{
+public:
+	virtual ~Dictionary() {}
+
+	/**
+	 * @brief Check the specified word.
+	 * @param utf8 The null-terminated UTF-8 encoding of the word.
+	 * @param length The length of the encoding, in bytes.
+	 * @return Whether the word is correct.
+	 */
+	virtual bool check(const char* utf8, int length) = 0;
+
+	/**
+	 * @brief Retreive a list of spelling suggestions for the misspelled word.
+	 * @param word The misspelled word.
+	 * @return A list of spelling suggestions, the most likely first.
+	 */
+	virtual QList<QString> suggest(const QString& word) = 0;
+
+	/**
+	 * @brief Add the specified word to the user dictionary. The word must be
+	 *        correct from now on, but may be written to the user dictionary
+	 *        later.
+	 * @param word The word to add.
+	 */
+	virtual void add(const QString& word) = 0;
+
+	/**
+	 * @brief Accept the specified word as long as the dictionary exists.
+	 * @param word The word to accept.
+	 */
+	virtual void addToSession(const QString& word) = 0;
+
+	/**
+	 * @brief Stop accepting a word added with addToSession().
+	 * @param word The word to remove.
+	 */
+	virtual void removeFromSession(const QString& word) = 0;
+
+	/**
+	 * @brief Tell the dictionary which replacement the user chose for a
+	 *        misspelled word. The default implementation does nothing.
+	 * @param misspelling The misspelled word.
+	 * @param replacement The replacement of the misspelled word.
+	 */
+	virtual void storeReplacement(const QString& misspelling, const QString& replacement);
+};
+
+/**
+ * @brief A spell checking backend, providing the dictionaries of the
+ *        available languages.
+ * @note Dictionaries are requested, preloaded and destroyed from different
+ *       threads, the backend needs to serialize these operations.
+ */
+class QTSPELL_API Backend
+{
+public:
+	virtual ~Backend() {}
+
+	/**
+	 * @brief Requests the list of languages available for spell checking.
+	 * @return A list of languages, as locale specifiers (i.e. "en_US").
+	 */
+	virtual QList<QString> listLanguages() = 0;
+
+	/**
+	 * @brief Check whether the dictionary for a language is available. The
+	 *        default implementation looks the language up in listLanguages().
+	 * @param lang The language, as a locale specifier.
+	 * @return Whether the dictionary is available.
+	 */
+	virtual bool hasLanguage(const QString& lang);
+
+	/**
+	 * @brief Loads the dictionary of the specified language.
+	 * @param lang The language, as a locale specifier.
+	 * @return The dictionary, owned by the caller, or 0 on failure.
+	 */
+	virtual Dictionary* requestDictionary(const QString& lang) = 0;
+
+	/**
+	 * @brief Loads the dictionary of the specified language ahead of time,
+	 *        so that later requests for it are fast. Called from a background
+	 *        thread. The default implementation does nothing.
+	 * @param lang The language, as a locale specifier.
+	 */
+	virtual void preload(const QString& lang);
+
+	/**
+	 * @brief Sets the backend used by all checkers. Must be called before
+	 *        any checker is created. Blocks until the dictionaries being
+	 *        preloaded by the previous backend are loaded.
+	 * @param backend The backend, which is taken ownership of, or 0 to use
+	 *        the enchant backend.
+	 */
+	static void setDefault(Backend* backend);
+
+	/**
+	 * @brief Returns the backend used by all checkers, by default the
+	 *        enchant backend.
+	 * @return The backend.
+	 */
+	static Backend* getDefault();
+
+	/**
+	 * @brief Creates a backend serving dictionaries from word lists held in
+	 *        memory, which behaves the same on every system, i.e. for tests
+	 *        and benchmarks. Suggestions are the words within an edit
+	 *        distance of two, closest and first listed first. Words added to
+	 *        the user dictionary are kept in memory only.
+	 * @param wordLists The correct words of each language.
+	 * @return The backend, owned by the caller.
+	 */
+	static Backend* createMemoryBackend(const QMap<QString, QList<QString>>& wordLists);
+
+	/**
+	 * @brief Creates a backend calling hunspell directly instead of through
+	 *        enchant, which is faster but only finds hunspell dictionaries.
+	 *        Words added to the user dictionary are stored separately from
+	 *        the enchant user dictionary.
+	 * @param searchPaths The directories containing the .aff and .dic files,
+	 *        or an empty list for the directories in the DICPATH environment
+	 *        variable and the usual system directories.
+	 * @return The backend, owned by the caller, or 0 if QtSpell was built
+	 *         without hunspell support.
+	 */
+	static Backend* createHunspellBackend(const QList<QString>& searchPaths = QList<QString>());
+
+private:
+	friend class Checker;
+
+	// Preloads the dictionaries in a thread which is waited for before the default backend is deleted
+	static void preloadDefault(const QList<QString>& langs);
+	// The languages of the default backend, cached until it is replaced or the cache is invalidated
+	static QList<QString> defaultLanguages();
+	static void invalidateDefaultLanguages();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 /**
  * @brief An abstract class providing spell checking support.
  */
@@ -68,7 +217,8 @@ public:
 	virtual void checkSpelling(int start = 0, int end = -1) = 0;
 
 	/**
-	 * @brief Set the spell checking language.
+	 * @brief Set the spell checking language. Text edits are rechecked in the
+	 *        background.
 	 * @param lang The language, as a locale specifier (i.e. "en_US"), or an
 	 *             empty string to attempt to use the system locale.
 	 * @return true on success, false on failure.
@@ -113,7 +263,31 @@ public:
 	bool getSpellingEnabled() const;
 
 	/**
-	 * @brief Add the specified word to the user dictionary
+	 * @brief Set whether misspelled words are automatically replaced by the
+	 *        suggestion previously chosen for them, as soon as they are typed.
+	 * @param enabled Whether known misspellings are corrected automatically.
+	 */
+	void setAutoCorrectEnabled(bool enabled);
+
+	/**
+	 * @brief Return whether known misspellings are corrected automatically.
+	 * @return Whether known misspellings are corrected automatically.
+	 */
+	bool getAutoCorrectEnabled() const;
+
+	/**
+	 * @brief Remembers a replacement for a misspelled word. The replacement
+	 *        is stored persistently for the current language, and is offered
+	 *        as the first suggestion for the misspelled word from now on.
+	 * @param misspelling The misspelled word.
+	 * @param replacement The replacement of the misspelled word.
+	 */
+	void storeReplacement(const QString& misspelling, const QString& replacement);
+
+	/**
+	 * @brief Add the specified word to the user dictionary. The word is
+	 *        known immediately, the user dictionary is written in the
+	 *        background.
 	 * @param word The word to add to the dictionary
 	 */
 	void addWordToDictionary(const QString& word);
@@ -125,12 +299,50 @@ public:
 	 */
 	bool checkWord(const QString& word) const;
 
+	/**
+	 * @brief Sets an index of known correct words of the current language,
+	 *        which is consulted before the dictionary. Words not found in
+	 *        the index are looked up in the dictionary.
+	 * @param indexPath The index file, as written by buildWordIndex(), or
+	 *        an empty string to remove the index.
+	 * @return Whether the index was loaded.
+	 * @note The index is removed when the language is changed.
+	 */
+	bool setWordIndex(const QString& indexPath);
+
+	/**
+	 * @brief Builds a word index file from a word list, to be used with
+	 *        setWordIndex().
+	 * @param wordListPath A UTF-8 text file containing one correct word per
+	 *        line, i.e. a hunspell dictionary expanded with unmunch. A
+	 *        hunspell .dic file with its .aff file next to it is accepted
+	 *        too, but only its stems which are words by themselves are
+	 *        indexed, not their affixed forms.
+	 * @param indexPath The index file to write.
+	 * @return Whether the index file was written.
+	 */
+	static bool buildWordIndex(const QString& wordListPath, const QString& indexPath);
+
 	/**
 	 * @brief Ignore a word for the current session.
 	 * @param word The word to ignore.
 	 */
 	void ignoreWord(const QString& word) const;
 
+	/**
+	 * @brief Returns the words ignored with ignoreWord(), i.e. to store them
+	 *        along with a document.
+	 * @return The ignored words, sorted.
+	 */
+	QList<QString> getIgnoredWords() const;
+
+	/**
+	 * @brief Sets the ignored words, replacing the current ones, i.e. to
+	 *        restore the words stored along with a document.
+	 * @param words The words to ignore.
+	 */
+	void setIgnoredWords(const QList<QString>& words);
+
 	/**
 	 * @brief Retreive a list of spelling suggestions for the misspelled word.
 	 * @param word The misspelled word.
@@ -138,13 +350,72 @@ public:
 	 */
 	QList<QString> getSpellingSuggestions(const QString& word) const;
 
+	/**
+	 * @brief Sets an index of the words of the current language from which
+	 *        spelling suggestions are computed. The index is looked up case
+	 *        insensitively, and the suggestions take the capitalization of
+	 *        the misspelled word. Unless setMergeSuggestions() is enabled,
+	 *        the dictionary is only asked for suggestions if the index
+	 *        contains no word close to the misspelled word.
+	 * @param indexPath The index file, as written by buildSuggestionIndex(),
+	 *        or an empty string to remove the index.
+	 * @return Whether the index was loaded.
+	 * @note The index is removed when the language is changed.
+	 */
+	bool setSuggestionIndex(const QString& indexPath);
+
+	/**
+	 * @brief Set whether the suggestions of the dictionary are appended to
+	 *        those of the suggestion index, rather than only used if the
+	 *        index has none. Disabled by default.
+	 * @param merge Whether to merge the suggestions of both sources.
+	 */
+	void setMergeSuggestions(bool merge);
+
+	/**
+	 * @brief Return whether the suggestions of the dictionary are merged
+	 *        with those of the suggestion index.
+	 * @return Whether the suggestions of both sources are merged.
+	 */
+	bool getMergeSuggestions() const;
+
+	/**
+	 * @brief Builds a suggestion index file from a word list, to be used
+	 *        with setSuggestionIndex().
+	 * @param wordListPath A UTF-8 text file containing one correct word per
+	 *        line, i.e. an expanded hunspell dictionary. If the words are
+	 *        sorted by frequency, more frequent words are suggested first.
+	 * @param indexPath The index file to write.
+	 * @param maxDistance The maximum edit distance between a misspelled word
+	 *        and its suggestions.
+	 * @return Whether the index file was written.
+	 */
+	static bool buildSuggestionIndex(const QString& wordListPath, const QString& indexPath, int maxDistance = 2);
+
 
 	/**
 	 * @brief Requests the list of languages available for spell checking.
+	 *        The list is requested from the backend once and cached until
+	 *        the backend is replaced or refreshLanguageList() is called.
 	 * @return A list of languages available for spell checking.
 	 */
 	static QList<QString> getLanguageList();
 
+	/**
+	 * @brief Discards the cached list of languages, so that it is requested
+	 *        from the backend again, i.e. after dictionaries were installed.
+	 */
+	static void refreshLanguageList();
+
+	/**
+	 * @brief Loads the dictionaries of the specified languages in a background
+	 *        thread, so that later setLanguage() calls for these languages
+	 *        don't need to load them. Call this at application start to avoid
+	 *        loading the dictionaries on the GUI thread.
+	 * @param langs The languages, as locale specifiers (i.e. "en_US").
+	 */
+	static void preloadDictionaries(const QList<QString>& langs);
+
 	/**
 	 * @brief Translates a language code to a human readable format
 	 *        (i.e. "en_US" -> "English (United States)").
@@ -272,6 +543,49 @@ public:
 	 */
 	void setUndoRedoEnabled(bool enabled);
 
+	/**
+	 * @brief Sets the limits of the undo/redo history. When a limit is
+	 *        exceeded, the oldest undo steps are discarded.
+	 * @param maxBytes The maximum amount of memory used by the undo/redo
+	 *        history, in bytes, or -1 for no limit.
+	 * @param maxSteps The maximum number of undo/redo steps, or -1 for no
+	 *        limit.
+	 */
+	void setUndoRedoLimits(qint64 maxBytes, int maxSteps = -1);
+
+	/**
+	 * @brief Sets the number of recent undo steps which are kept in memory.
+	 *        Older undo steps are moved to a temporary journal file, and are
+	 *        read back when they are undone.
+	 * @param steps The number of undo steps kept in memory, or -1 to keep
+	 *        the whole undo history in memory.
+	 * @note Undo steps moved to the journal don't count towards the limits
+	 *       set with setUndoRedoLimits().
+	 */
+	void setUndoRedoJournalThreshold(int steps);
+
+	/**
+	 * @brief Returns the amount of memory currently used by the undo/redo
+	 *        history.
+	 * @return The memory used by the undo/redo history, in bytes.
+	 */
+	qint64 undoRedoMemoryUsage() const;
+
+	/**
+	 * @brief Records the edits of the checked text to a file, i.e. to replay
+	 *        a realistic editing session with the edit_replay benchmark.
+	 * @param path The file to write, or an empty string to stop recording.
+	 * @return Whether the file was opened.
+	 * @note Each line of the file is a record, with tab separated fields.
+	 *       "T" records contain the whole text, and are written when the
+	 *       recording starts and when the document is replaced. "E" records
+	 *       describe an edit by the milliseconds elapsed since the recording
+	 *       started, the position, the number of removed characters and the
+	 *       added text. In texts, backslashes, tabs and paragraph separators
+	 *       are escaped as \\\\, \\t and \\n.
+	 */
+	bool setEditRecording(const QString& path);
+
 public slots:
 	/**
 	 * @brief Undo the last edit operation.
@@ -289,6 +603,20 @@ public slots:
 	 */
 	void redo();
 
+	/**
+	 * @brief Undo the last edit operations. The text is checked once all
+	 *        operations were undone.
+	 * @param count The number of edit operations to undo.
+	 */
+	void undoSteps(int count);
+
+	/**
+	 * @brief Redo the last undone edit operations. The text is checked once
+	 *        all operations were redone.
+	 * @param count The number of edit operations to redo.
+	 */
+	void redoSteps(int count);
+
 	/**
 	 * @brief Clears the undo/redo stack.
 	 * @note QtSpell::TextEditChecker reimplements the undo/redo functionality
@@ -329,9 +657,113 @@ private slots:
 	void slotCheckRange(int pos, int removed, int added);
 
 private:
+	friend class CheckerGroupPrivate;
+	TextEditChecker(CheckerGroupPrivate* group, QObject* parent);
+
 	Q_DECLARE_PRIVATE(TextEditChecker)
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Checks any number of text edits with one dictionary. The text edits
+ *        share the dictionary and its verdicts, and are checked in the
+ *        background, so that the cost of a checked text edit depends on its
+ *        content only.
+ */
+class QTSPELL_API CheckerGroup : public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * @brief CheckerGroup object constructor. The group uses the language of
+	 *        the system locale until setLanguage() is called.
+	 */
+	CheckerGroup(QObject* parent = 0);
+
+	/**
+	 * @brief CheckerGroup object destructor, detaches all text edits.
+	 */
+	~CheckerGroup();
+
+	/**
+	 * @brief Starts checking the specified QTextEdit. Its text is checked in
+	 *        the background.
+	 * @param textEdit The QTextEdit to check.
+	 * @return The checker of the text edit, owned by the group, i.e. to
+	 *         configure its undo/redo.
+	 */
+	TextEditChecker* attach(QTextEdit* textEdit);
+
+	/**
+	 * @brief Starts checking the specified QPlainTextEdit. Its text is checked
+	 *        in the background.
+	 * @param textEdit The QPlainTextEdit to check.
+	 * @return The checker of the text edit, owned by the group, i.e. to
+	 *         configure its undo/redo.
+	 */
+	TextEditChecker* attach(QPlainTextEdit* textEdit);
+
+	/**
+	 * @brief Stops checking the specified text edit. Text edits are detached
+	 *        automatically when they are destroyed.
+	 * @param textEdit The QTextEdit or QPlainTextEdit to detach.
+	 */
+	void detach(QObject* textEdit);
+
+	/**
+	 * @brief Returns the checkers of the attached text edits.
+	 * @return The checkers.
+	 */
+	QList<TextEditChecker*> getCheckers() const;
+
+	/**
+	 * @brief Set the spell checking language of all text edits.
+	 * @param lang The language, as a locale specifier (i.e. "en_US"), or an
+	 *             empty string to attempt to use the system locale.
+	 * @return true on success, false on failure.
+	 */
+	bool setLanguage(const QString& lang);
+
+	/**
+	 * @brief Retreive the current spelling language.
+	 * @return The current spelling language.
+	 */
+	QString getLanguage() const;
+
+	/**
+	 * @brief Set whether to decode language codes in the UI of all text edits.
+	 * @param decode Whether to decode the language codes.
+	 */
+	void setDecodeLanguageCodes(bool decode);
+
+	/**
+	 * @brief Set whether to display an "Check spelling" checkbox in the UI of
+	 *        all text edits.
+	 * @param show Whether to display an "Check spelling" checkbox in the UI.
+	 */
+	void setShowCheckSpellingCheckbox(bool show);
+
+public slots:
+	/**
+	 * @brief Set whether spell checking should be performed in all text edits.
+	 * @param enabled True if spell checking should be performed.
+	 */
+	void setSpellingEnabled(bool enabled);
+
+signals:
+	/**
+	 * @brief This signal is emitted when the user selects a new language from
+	 *        the spellchecker UI of one of the text edits.
+	 * @param newLang The new language, as a locale specifier.
+	 */
+	void languageChanged(const QString& newLang);
+
+private:
+	CheckerGroupPrivate* d_ptr;
+	Q_DECLARE_PRIVATE(CheckerGroup)
+};
+
 } // QtSpell
 
 #endif // QTSPELL_HPP
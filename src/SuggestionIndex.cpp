@@ -0,0 +1,247 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SuggestionIndex.hpp"
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QVector>
+#include <QtDebug>
+#include <algorithm>
+
+namespace QtSpell {
+
+// Adds all strings obtained by deleting up to distance characters from text to deletes
+static void collectDeletes(const QString& text, int distance, QSet<QString>& deletes)
+{
+	if(distance == 0 || text.length() <= 1){
+		return;
+	}
+	for(int i = 0, n = text.length(); i < n; ++i){
+		QString shorter = text;
+		shorter.remove(i, 1);
+		if(!deletes.contains(shorter)){
+			deletes.insert(shorter);
+			collectDeletes(shorter, distance - 1, deletes);
+		}
+	}
+}
+
+bool SuggestionIndex::build(const QString& wordListPath, const QString& indexPath, int maxDistance)
+{
+	QFile listFile(wordListPath);
+	if(!listFile.open(QIODevice::ReadOnly)){
+		qWarning() << "Failed to open word list: " << listFile.errorString();
+		return false;
+	}
+	// Keep the order of the list, it determines the ranking of suggestions with the same distance
+	QVector<QString> words;
+	QSet<QString> known;
+	while(!listFile.atEnd()){
+		QByteArray line = listFile.readLine();
+		int slash = line.indexOf('/');
+		if(slash >= 0){
+			line.truncate(slash);
+		}
+		QString word = QString::fromUtf8(line.trimmed());
+		if(!word.isEmpty() && !known.contains(word)){
+			known.insert(word);
+			words.append(word);
+		}
+	}
+
+	QVector<quint32> wordOffsets;
+	QString text;
+	QVector<Entry> entries;
+	for(int i = 0, n = words.size(); i < n; ++i){
+		const QString& word = words[i];
+		wordOffsets.append(text.length());
+		text.append(word);
+		// The deletes are case insensitive, the word is stored as listed to keep the case of i.e. names
+		QString prefix = word.left(PrefixLength).toLower();
+		QSet<QString> deletes;
+		deletes.insert(prefix);
+		collectDeletes(prefix, maxDistance, deletes);
+		for(const QString& del : deletes){
+			entries.append(Entry{hash(del.constData(), del.length()), quint32(i)});
+		}
+	}
+	wordOffsets.append(text.length());
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+		return a.hash < b.hash || (a.hash == b.hash && a.word < b.word);
+	});
+
+	Header header;
+	header.magic = Magic;
+	header.version = Version;
+	header.maxDistance = maxDistance;
+	header.prefixLength = PrefixLength;
+	header.wordCount = words.size();
+	header.entryCount = entries.size();
+	header.textLength = text.length();
+	QSaveFile indexFile(indexPath);
+	if(!indexFile.open(QIODevice::WriteOnly)){
+		qWarning() << "Failed to create suggestion index: " << indexFile.errorString();
+		return false;
+	}
+	indexFile.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	indexFile.write(reinterpret_cast<const char*>(wordOffsets.constData()), wordOffsets.size() * sizeof(quint32));
+	indexFile.write(reinterpret_cast<const char*>(entries.constData()), entries.size() * sizeof(Entry));
+	indexFile.write(reinterpret_cast<const char*>(text.constData()), text.length() * sizeof(QChar));
+	if(!indexFile.commit()){
+		qWarning() << "Failed to write suggestion index: " << indexFile.errorString();
+		return false;
+	}
+	return true;
+}
+
+bool SuggestionIndex::load(const QString& indexPath)
+{
+	m_file.setFileName(indexPath);
+	if(!m_file.open(QIODevice::ReadOnly)){
+		qWarning() << "Failed to open suggestion index: " << m_file.errorString();
+		return false;
+	}
+	qint64 size = m_file.size();
+	const uchar* data = size >= qint64(sizeof(Header)) ? m_file.map(0, size) : nullptr;
+	if(!data){
+		qWarning() << "Failed to map suggestion index: " << m_file.errorString();
+		m_file.close();
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(data);
+	qint64 expectedSize = sizeof(Header) + (qint64(header->wordCount) + 1) * sizeof(quint32) + qint64(header->entryCount) * sizeof(Entry) + qint64(header->textLength) * sizeof(QChar);
+	if(header->magic != Magic || header->version != Version || header->prefixLength != PrefixLength || size != expectedSize){
+		qWarning() << "Invalid suggestion index: " << indexPath;
+		m_file.close();
+		return false;
+	}
+	m_header = header;
+	m_wordOffsets = reinterpret_cast<const quint32*>(data + sizeof(Header));
+	m_entries = reinterpret_cast<const Entry*>(m_wordOffsets + header->wordCount + 1);
+	m_text = reinterpret_cast<const QChar*>(m_entries + header->entryCount);
+	return true;
+}
+
+QList<QString> SuggestionIndex::suggest(const QString& word, int maxResults) const
+{
+	QList<QString> suggestions;
+	if(!m_header){
+		return suggestions;
+	}
+	int maxDistance = m_header->maxDistance;
+	QString lowerWord = word.toLower();
+	QSet<QString> deletes;
+	QString prefix = lowerWord.left(PrefixLength);
+	deletes.insert(prefix);
+	collectDeletes(prefix, maxDistance, deletes);
+
+	// Verify the candidates sharing a delete with the word, hash collisions are weeded out by the edit distance
+	QSet<quint32> seen;
+	QVector<QPair<int, quint32>> candidates;
+	for(const QString& del : deletes){
+		quint32 h = hash(del.constData(), del.length());
+		const Entry* end = m_entries + m_header->entryCount;
+		const Entry* it = std::lower_bound(m_entries, end, h, [](const Entry& entry, quint32 h){ return entry.hash < h; });
+		for(; it != end && it->hash == h; ++it){
+			if(it->word >= m_header->wordCount || seen.contains(it->word)){
+				continue;
+			}
+			seen.insert(it->word);
+			quint32 start = m_wordOffsets[it->word];
+			quint32 stop = m_wordOffsets[it->word + 1];
+			if(start > stop || stop > m_header->textLength){
+				continue;
+			}
+			QString candidate(m_text + start, stop - start);
+			QString lowerCandidate = candidate.toLower();
+			int distance = editDistance(lowerWord.constData(), lowerWord.length(), lowerCandidate.constData(), lowerCandidate.length(), maxDistance);
+			// A candidate differing only in case is a suggestion too, i.e. "Paris" for "paris"
+			if(distance <= maxDistance && candidate != word){
+				candidates.append(qMakePair(distance, it->word));
+			}
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for(int i = 0, n = candidates.size(); i < n && suggestions.size() < maxResults; ++i){
+		quint32 start = m_wordOffsets[candidates[i].second];
+		quint32 stop = m_wordOffsets[candidates[i].second + 1];
+		QString suggestion = matchCase(QString(m_text + start, stop - start), word);
+		if(suggestion != word && !suggestions.contains(suggestion)){
+			suggestions.append(suggestion);
+		}
+	}
+	return suggestions;
+}
+
+QString SuggestionIndex::matchCase(const QString& suggestion, const QString& word)
+{
+	// An all uppercase word gets uppercase suggestions, a capitalized word capitalized ones. Suggestions
+	// capitalized in the word list, i.e. names, are left alone.
+	if(word.isEmpty() || suggestion.isEmpty() || !word.at(0).isUpper()){
+		return suggestion;
+	}
+	if(word.length() > 1 && word == word.toUpper()){
+		return suggestion.toUpper();
+	}
+	QString capitalized = suggestion;
+	capitalized[0] = capitalized.at(0).toUpper();
+	return capitalized;
+}
+
+quint32 SuggestionIndex::hash(const QChar* text, int length)
+{
+	// FNV-1a, the hashes are stored in the index file and must not depend on the process
+	quint32 h = 2166136261u;
+	for(int i = 0; i < length; ++i){
+		h = (h ^ text[i].unicode()) * 16777619u;
+	}
+	return h;
+}
+
+int SuggestionIndex::editDistance(const QChar* a, int lengthA, const QChar* b, int lengthB, int maxDistance)
+{
+	// Damerau-Levenshtein distance (optimal string alignment), abandoned as soon as it exceeds maxDistance
+	if(qAbs(lengthA - lengthB) > maxDistance){
+		return maxDistance + 1;
+	}
+	QVector<int> prevPrev(lengthB + 1), prev(lengthB + 1), cur(lengthB + 1);
+	for(int j = 0; j <= lengthB; ++j){
+		prev[j] = j;
+	}
+	for(int i = 1; i <= lengthA; ++i){
+		cur[0] = i;
+		int rowMin = cur[0];
+		for(int j = 1; j <= lengthB; ++j){
+			int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+			cur[j] = qMin(qMin(prev[j] + 1, cur[j - 1] + 1), prev[j - 1] + cost);
+			if(i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]){
+				cur[j] = qMin(cur[j], prevPrev[j - 2] + 1);
+			}
+			rowMin = qMin(rowMin, cur[j]);
+		}
+		if(rowMin > maxDistance){
+			return maxDistance + 1;
+		}
+		std::swap(prevPrev, prev);
+		std::swap(prev, cur);
+	}
+	return prev[lengthB];
+}
+
+} // QtSpell
@@ -0,0 +1,111 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_SUGGESTIONINDEX_HPP
+#define QTSPELL_SUGGESTIONINDEX_HPP
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+namespace QtSpell {
+
+/**
+ * @brief Read-only symmetric delete index for spelling suggestions. Every
+ *        word is indexed under all strings obtained by deleting up to the
+ *        maximum edit distance characters from its prefix, so that the
+ *        candidates for a misspelled word are found by looking up the
+ *        deletes of the misspelled word. The index file is memory mapped.
+ */
+class SuggestionIndex
+{
+public:
+	/**
+	 * @brief Builds an index file from a word list.
+	 * @param wordListPath A UTF-8 text file containing one word per line.
+	 *        Anything following a slash (i.e. hunspell affix flags) is
+	 *        ignored. Words listed first are ranked first among suggestions
+	 *        with the same edit distance.
+	 * @param indexPath The index file to write.
+	 * @param maxDistance The maximum edit distance of suggestions.
+	 * @return Whether the index file was written.
+	 */
+	static bool build(const QString& wordListPath, const QString& indexPath, int maxDistance);
+
+	/**
+	 * @brief Maps the specified index file.
+	 * @param indexPath The index file, as written by build().
+	 * @return Whether the index file is valid and was mapped.
+	 */
+	bool load(const QString& indexPath);
+
+	/**
+	 * @brief Returns the words closest to the specified word, ordered by
+	 *        edit distance. The words are compared case insensitively, and
+	 *        the suggestions are capitalized like the misspelled word.
+	 * @param word The misspelled word.
+	 * @param maxResults The maximum number of suggestions.
+	 * @return The suggestions.
+	 */
+	QList<QString> suggest(const QString& word, int maxResults) const;
+
+	/**
+	 * @brief Computes the Damerau-Levenshtein distance (optimal string
+	 *        alignment) between two strings.
+	 * @param a The first string.
+	 * @param lengthA The length of the first string.
+	 * @param b The second string.
+	 * @param lengthB The length of the second string.
+	 * @param maxDistance The distance above which the computation is given up.
+	 * @return The distance, or a value above maxDistance if it exceeds maxDistance.
+	 */
+	static int editDistance(const QChar* a, int lengthA, const QChar* b, int lengthB, int maxDistance);
+
+private:
+	struct Header {
+		quint32 magic;
+		quint32 version;
+		quint32 maxDistance;
+		quint32 prefixLength;
+		quint32 wordCount;
+		quint32 entryCount;
+		quint32 textLength;
+	};
+	// Maps the hash of a delete to a word, the entries are sorted by hash
+	struct Entry {
+		quint32 hash;
+		quint32 word;
+	};
+	static constexpr quint32 Magic = 0x49535351; // "QSSI"
+	// Version 2 indexes the lower-cased deletes
+	static constexpr quint32 Version = 2;
+	static constexpr int PrefixLength = 7;
+
+	QFile m_file;
+	const Header* m_header = nullptr;
+	const quint32* m_wordOffsets = nullptr;
+	const Entry* m_entries = nullptr;
+	const QChar* m_text = nullptr;
+
+	static quint32 hash(const QChar* text, int length);
+	static QString matchCase(const QString& suggestion, const QString& word);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_SUGGESTIONINDEX_HPP
@@ -18,22 +18,357 @@
 
 #include "QtSpell.hpp"
 #include "TextEditChecker_p.hpp"
+#include "CheckerGroup_p.hpp"
+#include "IdleScheduler.hpp"
 #include "UndoRedoStack.hpp"
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QPlainTextEdit>
 #include <QTextEdit>
 #include <QTextBlock>
+#include <algorithm>
 
 namespace QtSpell {
 
-TextEditCheckerPrivate::TextEditCheckerPrivate()
+// Changes larger than this many characters are checked in the background
+static const int BackgroundCheckThreshold = 50000;
+// Number of characters checked at once by the background check
+static const int BackgroundCheckChunkSize = 2000;
+
+TextEditCheckerPrivate::TextEditCheckerPrivate(CheckerGroupPrivate* checkerGroup)
 	: CheckerPrivate()
+	, group(checkerGroup)
 {
 }
 
 TextEditCheckerPrivate::~TextEditCheckerPrivate()
 {
+	clearMisspellings();
+	delete editRecording;
+}
+
+static QByteArray escapeRecordedText(const QString& text)
+{
+	QString escaped;
+	escaped.reserve(text.length());
+	for(QChar ch : text){
+		if(ch == QLatin1Char('\\')){
+			escaped += QLatin1String("\\\\");
+		}else if(ch == QLatin1Char('\t')){
+			escaped += QLatin1String("\\t");
+		}else if(ch == QLatin1Char('\n') || ch == QChar::ParagraphSeparator){
+			escaped += QLatin1String("\\n");
+		}else{
+			escaped += ch;
+		}
+	}
+	return escaped.toUtf8();
+}
+
+void TextEditCheckerPrivate::recordText()
+{
+	if(editRecording && document){
+		editRecording->write("T\t" + escapeRecordedText(document->toPlainText()) + '\n');
+	}
+}
+
+void TextEditCheckerPrivate::recordEdit(int pos, int removed, int added)
+{
+	QTextCursor cursor(document);
+	cursor.setPosition(pos);
+	cursor.setPosition(pos + added, QTextCursor::KeepAnchor);
+	editRecording->write("E\t" + QByteArray::number(editRecordingTimer.elapsed()) + '\t' + QByteArray::number(pos) + '\t' +
+						 QByteArray::number(removed) + '\t' + escapeRecordedText(cursor.selectedText()) + '\n');
+}
+
+void TextEditCheckerPrivate::initLanguage()
+{
+	if(group){
+		setSharedDictionary(group->lang, group->speller, group->verdicts, &group->replacements, &group->ignoredWords, &group->knownWords);
+	}else{
+		CheckerPrivate::initLanguage();
+	}
+}
+
+bool TextEditCheckerPrivate::setLanguageInternal(const QString& newLang)
+{
+	// All checkers of a group use the same language
+	if(group){
+		return group->setLanguage(newLang);
+	}
+	return CheckerPrivate::setLanguageInternal(newLang);
+}
+
+void TextEditCheckerPrivate::scheduleCheck(int start, int end)
+{
+	if(pendingCheck.isNull()){
+		pendingCheck = QTextCursor(document);
+		pendingCheck.setPosition(start);
+	}else{
+		int pendingStart = pendingCheck.selectionStart();
+		int pendingEnd = pendingCheck.selectionEnd();
+		pendingCheck.setPosition(qMin(start, pendingStart));
+		end = qMax(end, pendingEnd);
+	}
+	pendingCheck.setPosition(end, QTextCursor::KeepAnchor);
+	IdleScheduler::instance()->schedule(this);
+}
+
+void TextEditCheckerPrivate::cancelScheduledCheck()
+{
+	IdleScheduler::cancel(this);
+	pendingCheck = QTextCursor();
+}
+
+void TextEditCheckerPrivate::recheckAll()
+{
+	if(document){
+		scheduleCheck(0, document->characterCount() - 1);
+	}
+}
+
+void TextEditCheckerPrivate::recheckAllSharingDictionary()
+{
+	if(group){
+		group->recheckAll();
+	}else{
+		recheckAll();
+	}
+}
+
+void TextEditCheckerPrivate::recheckRange(int start, int end)
+{
+	Q_Q(TextEditChecker);
+	// Only formats change, which must not reach slotCheckRange (and the undo stack) when the range is checked
+	// outside of a contentsChange emission, i.e. after undo/redo steps
+	bool signalsWereBlocked = document->blockSignals(true);
+	QTextCursor c(document);
+	c.beginEditBlock();
+	c.setPosition(start);
+	c.setPosition(end, QTextCursor::KeepAnchor);
+	removeSpellingFormat(c);
+	// The underlines were reset, so misspellings in the range need to be marked anew
+	takeMisspellings(start, end);
+	if(end - start > BackgroundCheckThreshold){
+		scheduleCheck(start, end);
+	}else{
+		q->checkSpelling(start, end);
+	}
+	c.endEditBlock();
+	document->blockSignals(signalsWereBlocked);
+}
+
+void TextEditCheckerPrivate::autoCorrectWordBefore(int pos)
+{
+	Q_Q(TextEditChecker);
+	// Only correct a word once it is complete, i.e. a word separator was typed after it
+	TextCursor c(document);
+	c.setPosition(pos);
+	QString separator = c.nextChar();
+	if(pos == 0 || separator == "'" || c.isWordChar(separator) || !c.isWordChar(c.prevChar())){
+		return;
+	}
+	c.setPosition(pos - 1);
+	c.moveWordStart();
+	c.setPosition(pos, QTextCursor::KeepAnchor);
+	QString word = c.selectedText();
+	QString replacement = replacements->value(word);
+	if(replacement.isEmpty() || noSpellingPropertySet(c) || q->checkWord(word)){
+		return;
+	}
+	// The document must not be modified while its change is being handled
+	QTextCursor target(c);
+	QTimer::singleShot(0, q, [target, word, replacement]() mutable {
+		if(target.selectedText() == word){
+			target.insertText(replacement);
+		}
+	});
+}
+
+void TextEditCheckerPrivate::deferCheck(int start, int end)
+{
+	if(deferredCheck.isNull()){
+		deferredCheck = QTextCursor(document);
+		deferredCheck.setPosition(start);
+	}else{
+		deferredCheck.setPosition(qMin(start, deferredCheck.selectionStart()));
+		end = qMax(end, deferredCheck.selectionEnd());
+	}
+	deferredCheck.setPosition(end, QTextCursor::KeepAnchor);
+}
+
+void TextEditCheckerPrivate::checkDeferred()
+{
+	if(deferredCheck.isNull()){
+		return;
+	}
+	int start = deferredCheck.selectionStart();
+	int end = deferredCheck.selectionEnd();
+	deferredCheck = QTextCursor();
+	recheckRange(start, end);
+}
+
+void TextEditCheckerPrivate::insertMisspellings(const QVector<Misspelling>& found)
+{
+	if(found.isEmpty()){
+		return;
+	}
+	// The misspellings found by a check are sorted and fill the gap left by takeMisspellings, so they are inserted at once
+	auto it = std::upper_bound(misspellings.begin(), misspellings.end(), found.first().start, [](int pos, const Misspelling* m){ return pos < m->start; });
+	int index = it - misspellings.begin();
+	misspellings.insert(index, found.size(), nullptr);
+	for(int i = 0, n = found.size(); i < n; ++i){
+		Misspelling* misspelling = new Misspelling(found[i]);
+		misspellings[index + i] = misspelling;
+		misspellingIndex[misspelling->word].append(misspelling);
+	}
+}
+
+QVector<TextEditCheckerPrivate::Misspelling> TextEditCheckerPrivate::takeMisspellings(int start, int end)
+{
+	QVector<Misspelling> taken;
+	// Misspellings are sorted by position, and shifting preserves their relative order
+	auto first = std::lower_bound(misspellings.begin(), misspellings.end(), start, [](const Misspelling* m, int pos){ return m->end < pos; });
+	auto kept = first;
+	auto it = first;
+	for(; it != misspellings.end() && (*it)->start <= end; ++it){
+		Misspelling* misspelling = *it;
+		// Words which merely touch the range are left alone, collapsed ranges (deleted words) are removed
+		bool overlaps = misspelling->start == misspelling->end || (misspelling->start < end && misspelling->end > start);
+		if(!overlaps){
+			*kept++ = misspelling;
+			continue;
+		}
+		if(misspelling->cleared){
+			--clearedMisspellings;
+		}else{
+			taken.append(*misspelling);
+			removeFromIndex(misspelling);
+		}
+		delete misspelling;
+	}
+	misspellings.erase(kept, it);
+	return taken;
+}
+
+void TextEditCheckerPrivate::shiftMisspellings(int pos, int removed, int added)
+{
+	// Positions in the removed text collapse to its start, positions after it move by the change in length, as
+	// those of a QTextCursor would
+	auto shift = [pos, removed, added](int p){
+		return p < pos ? p : p < pos + removed ? pos : p + added - removed;
+	};
+	auto it = std::lower_bound(misspellings.begin(), misspellings.end(), pos, [](const Misspelling* m, int pos){ return m->end < pos; });
+	for(auto itEnd = misspellings.end(); it != itEnd; ++it){
+		(*it)->start = shift((*it)->start);
+		(*it)->end = shift((*it)->end);
+	}
+}
+
+void TextEditCheckerPrivate::clearMisspellings()
+{
+	qDeleteAll(misspellings);
+	misspellings.clear();
+	misspellingIndex.clear();
+	clearedMisspellings = 0;
+}
+
+void TextEditCheckerPrivate::removeFromIndex(Misspelling* misspelling)
+{
+	auto it = misspellingIndex.find(misspelling->word);
+	if(it != misspellingIndex.end()){
+		it.value().removeOne(misspelling);
+		if(it.value().isEmpty()){
+			misspellingIndex.erase(it);
+		}
+	}
+}
+
+QTextCursor TextEditCheckerPrivate::selectMisspelling(const Misspelling& misspelling) const
+{
+	QTextCursor cursor(document);
+	cursor.setPosition(misspelling.start);
+	cursor.setPosition(misspelling.end, QTextCursor::KeepAnchor);
+	return cursor;
+}
+
+void TextEditCheckerPrivate::removeSpellingFormat(const QTextCursor& cursor)
+{
+	// Reset the underline fragment by fragment, so that any other char formatting in the range is preserved
+	int start = cursor.selectionStart();
+	int end = cursor.selectionEnd();
+	QVector<QPair<QPair<int, int>, QTextCharFormat>> changes;
+	for(QTextBlock block = cursor.document()->findBlock(start); block.isValid() && block.position() < end; block = block.next()){
+		for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it){
+			QTextFragment fragment = it.fragment();
+			int fragmentStart = qMax(fragment.position(), start);
+			int fragmentEnd = qMin(fragment.position() + fragment.length(), end);
+			QTextCharFormat fmt = fragment.charFormat();
+			if(fragmentStart >= fragmentEnd || (!fmt.hasProperty(QTextFormat::TextUnderlineStyle) && !fmt.hasProperty(QTextFormat::FontUnderline) && !fmt.hasProperty(QTextFormat::TextUnderlineColor))){
+				continue;
+			}
+			fmt.clearProperty(QTextFormat::TextUnderlineStyle);
+			fmt.clearProperty(QTextFormat::FontUnderline);
+			fmt.clearProperty(QTextFormat::TextUnderlineColor);
+			changes.append(qMakePair(qMakePair(fragmentStart, fragmentEnd), fmt));
+		}
+	}
+	QTextCursor c(cursor.document());
+	for(const auto& change : changes){
+		c.setPosition(change.first.first);
+		c.setPosition(change.first.second, QTextCursor::KeepAnchor);
+		c.setCharFormat(change.second);
+	}
+}
+
+void TextEditCheckerPrivate::recheckWord(const QString& word, int /*start*/, int /*end*/)
+{
+	Q_Q(TextEditChecker);
+	if(!q->checkWord(word)){
+		return;
+	}
+	// The dictionary is shared by the group, so the word is now correct in all its checkers
+	if(group){
+		group->clearMisspelledWord(word);
+	}else{
+		clearMisspelledWord(word);
+	}
+}
+
+void TextEditCheckerPrivate::clearMisspelledWord(const QString& word)
+{
+	if(!textEdit){
+		return;
+	}
+	// The word is now correct: clear all its occurrences, no need to rescan the document
+	QVector<Misspelling*> occurrences = misspellingIndex.take(word);
+	if(occurrences.isEmpty()){
+		return;
+	}
+	document->blockSignals(true);
+	for(Misspelling* misspelling : occurrences){
+		if(misspelling->start < misspelling->end){
+			removeSpellingFormat(selectMisspelling(*misspelling));
+		}
+		// Removing each occurrence from the sorted list would be linear in the number of misspellings, so the
+		// occurrences are only flagged, and removed together once they make up half of the list
+		misspelling->cleared = true;
+	}
+	document->blockSignals(false);
+	clearedMisspellings += occurrences.size();
+	if(clearedMisspellings > misspellings.size() / 2){
+		auto kept = std::remove_if(misspellings.begin(), misspellings.end(), [](Misspelling* m){
+			if(m->cleared){
+				delete m;
+				return true;
+			}
+			return false;
+		});
+		misspellings.erase(kept, misspellings.end());
+		clearedMisspellings = 0;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -67,14 +402,14 @@ void TextCursor::moveWordStart(MoveMode moveMode)
 	// If we are in front of a quote...
 	if(nextChar() == "'"){
 		// If the previous char is alphanumeric, move left one word, otherwise move right one char
-		if(prevChar().contains(m_wordRegEx)){
+		if(isWordChar(prevChar())){
 			movePosition(WordLeft, moveMode);
 		}else{
 			movePosition(NextCharacter, moveMode);
 		}
 	}
 	// If the previous char is a quote, and the char before that is alphanumeric, move left one word
-	else if(prevChar() == "'" && prevChar(2).contains(m_wordRegEx)){
+	else if(prevChar() == "'" && isWordChar(prevChar(2))){
 		movePosition(WordLeft, moveMode, 2); // 2: because quote counts as a word boundary
 	}
 }
@@ -86,18 +421,52 @@ void TextCursor::moveWordEnd(MoveMode moveMode)
 	// If we are in behind of a quote...
 	if(prevChar() == "'"){
 		// If the next char is alphanumeric, move right one word, otherwise move left one char
-		if(nextChar().contains(m_wordRegEx)){
+		if(isWordChar(nextChar())){
 			movePosition(WordRight, moveMode);
 		}else{
 			movePosition(PreviousCharacter, moveMode);
 		}
 	}
 	// If the next char is a quote, and the char after that is alphanumeric, move right one word
-	else if(nextChar() == "'" && nextChar(2).contains(m_wordRegEx)){
+	else if(nextChar() == "'" && isWordChar(nextChar(2))){
 		movePosition(WordRight, moveMode, 2); // 2: because quote counts as a word boundary
+		// WordRight also skips the whitespace following the word
+		for(QString prev = prevChar(); !prev.isEmpty() && prev.at(0).isSpace(); prev = prevChar()){
+			movePosition(PreviousCharacter, moveMode);
+		}
 	}
 }
 
+// The word separators of QTextCursor, see QTextEngine::atWordSeparator
+static bool isWordSeparator(QChar ch)
+{
+	switch(ch.unicode()){
+	case '.': case ',': case '?': case '!': case '@': case '#': case '$': case ':': case ';': case '-':
+	case '<': case '>': case '[': case ']': case '(': case ')': case '{': case '}': case '=': case '/':
+	case '+': case '%': case '&': case '^': case '*': case '\'': case '"': case '`': case '~': case '|': case '\\':
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Returns the end of the word starting at start in the block text, as TextCursor::moveWordEnd would
+static int wordEnd(QStringView text, int start)
+{
+	auto runEnd = [text](int pos){
+		while(pos < text.length() && !text[pos].isSpace() && !isWordSeparator(text[pos])){
+			++pos;
+		}
+		return pos;
+	};
+	int end = runEnd(start);
+	// If the next char is a quote, and the char after that is alphanumeric, include the part after the quote
+	if(end + 1 < text.length() && text[end] == QLatin1Char('\'') && WordChars::isWordChar(text.mid(end + 1))){
+		end = runEnd(end + 1);
+	}
+	return end;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 TextEditChecker::TextEditChecker(QObject* parent)
@@ -105,6 +474,11 @@ TextEditChecker::TextEditChecker(QObject* parent)
 {
 }
 
+TextEditChecker::TextEditChecker(CheckerGroupPrivate* group, QObject* parent)
+	: Checker(*new TextEditCheckerPrivate(group), parent)
+{
+}
+
 TextEditChecker::~TextEditChecker()
 {
 	Q_D(TextEditChecker);
@@ -135,16 +509,14 @@ void TextEditCheckerPrivate::setTextEdit(TextEditProxy *newTextEdit)
 		textEdit->removeEventFilter(q);
 
 		// Remove spelling format
-		QTextCursor cursor = textEdit->textCursor();
-		cursor.movePosition(QTextCursor::Start);
-		cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-		QTextCharFormat fmt = cursor.charFormat();
-		QTextCharFormat defaultFormat = QTextCharFormat();
-		fmt.setFontUnderline(defaultFormat.fontUnderline());
-		fmt.setUnderlineColor(defaultFormat.underlineColor());
-		fmt.setUnderlineStyle(defaultFormat.underlineStyle());
-		cursor.setCharFormat(fmt);
+		for(const Misspelling* misspelling : misspellings){
+			if(!misspelling->cleared && misspelling->start < misspelling->end){
+				removeSpellingFormat(selectMisspelling(*misspelling));
+			}
+		}
 	}
+	clearMisspellings();
+	cancelScheduledCheck();
 	bool undoWasEnabled = undoRedoStack != nullptr;
 	q->setUndoRedoEnabled(false);
 	delete textEdit;
@@ -161,8 +533,14 @@ void TextEditCheckerPrivate::setTextEdit(TextEditProxy *newTextEdit)
 		q->setUndoRedoEnabled(undoWasEnabled);
 		textEdit->setContextMenuPolicy(Qt::CustomContextMenu);
 		textEdit->installEventFilter(q);
-		q->checkSpelling();
+		// The checkers of a group check their text in the background, so that attaching many text edits is fast
+		if(group || document->characterCount() > BackgroundCheckThreshold){
+			scheduleCheck(0, document->characterCount() - 1);
+		}else{
+			q->checkSpelling();
+		}
 		textEdit->document()->setModified(wasModified);
+		recordText();
         } else {
                 if(undoWasEnabled){
                         // Crate dummy instance
@@ -175,6 +553,8 @@ void TextEditChecker::setNoSpellingPropertyId(int propertyId)
 {
 	Q_D(TextEditChecker);
 	d->noSpellingProperty = propertyId;
+	d->noSpellingFormats.clear();
+	d->noSpellingRanges.clear();
 }
 
 int TextEditChecker::noSpellingPropertyId() const
@@ -211,47 +591,91 @@ void TextEditChecker::checkSpelling(int start, int end)
 	}
 
 	// stop contentsChange signals from being emitted due to changed charFormats
-	d->textEdit->document()->blockSignals(true);
+	bool signalsWereBlocked = d->textEdit->document()->blockSignals(true);
 
 	qDebug() << "Checking range " << start << " - " << end;
 
+	// If spelling is disabled, there is nothing to check, just clear the existing misspellings
+	if(!d->spellingEnabled){
+		for(const TextEditCheckerPrivate::Misspelling& misspelling : d->takeMisspellings(start, end)){
+			if(misspelling.start < misspelling.end){
+				TextEditCheckerPrivate::removeSpellingFormat(d->selectMisspelling(misspelling));
+			}
+		}
+		d->textEdit->document()->blockSignals(signalsWereBlocked);
+		return;
+	}
+
 	QTextCharFormat errorFmt;
 	errorFmt.setFontUnderline(true);
 	errorFmt.setUnderlineColor(Qt::red);
 	errorFmt.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-	QTextCharFormat defaultFormat = QTextCharFormat();
 
-	TextCursor cursor(d->textEdit->textCursor());
+	// Only words whose state changed since the last check get their format updated
+	QVector<TextEditCheckerPrivate::Misspelling> previous = d->takeMisspellings(start, end);
+	auto prevIt = previous.cbegin();
+	QVector<TextEditCheckerPrivate::Misspelling> found;
+	QVector<QTextCursor> stale;
+	QVector<QTextCursor> added;
+
+	// Words are sliced from the block text, so that checking a word doesn't allocate
+	QTextCursor cursor(d->document);
 	cursor.beginEditBlock();
-	cursor.setPosition(start);
-	while(cursor.position() < end) {
-		cursor.moveWordEnd(QTextCursor::KeepAnchor);
-		bool correct;
-		QString word = cursor.selectedText();
-		if(d->noSpellingPropertySet(cursor)) {
-			correct = true;
-			qDebug() << "Skipping word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << ")";
-		} else {
-			correct = checkWord(word);
-			qDebug() << "Checking word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << "), correct:" << correct;
-		}
-		if(!correct){
-			cursor.mergeCharFormat(errorFmt);
-		}else{
-			QTextCharFormat fmt = cursor.charFormat();
-			fmt.setFontUnderline(defaultFormat.fontUnderline());
-			fmt.setUnderlineColor(defaultFormat.underlineColor());
-			fmt.setUnderlineStyle(defaultFormat.underlineStyle());
-			cursor.setCharFormat(fmt);
+	for(QTextBlock block = d->document->findBlock(start); block.isValid() && block.position() < end; block = block.next()){
+		QString text = block.text();
+		int blockPos = block.position();
+		int pos = qMax(start - blockPos, 0);
+		int stop = qMin(end - blockPos, text.length());
+		while(pos < stop){
+			// Go to next word start
+			pos += WordChars::skipNonWordChars(text.constData() + pos, stop - pos);
+			if(pos >= stop){
+				break;
+			}
+			int wordStop = wordEnd(text, pos);
+			QStringView word = QStringView(text).mid(pos, wordStop - pos);
+			cursor.setPosition(blockPos + pos);
+			cursor.setPosition(blockPos + wordStop, QTextCursor::KeepAnchor);
+			pos = wordStop;
+			bool correct;
+			if(d->noSpellingPropertySet(cursor)) {
+				correct = true;
+				qDebug() << "Skipping word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << ")";
+			} else {
+				correct = d->checkWord(word);
+				qDebug() << "Checking word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << "), correct:" << correct;
+			}
+			if(!correct){
+				bool wasMisspelled = false;
+				for(; prevIt != previous.cend() && prevIt->start <= cursor.selectionStart(); ++prevIt){
+					if(prevIt->start == cursor.selectionStart() && prevIt->end == cursor.selectionEnd() && QStringView(prevIt->word) == word){
+						wasMisspelled = true;
+					}else if(prevIt->start < prevIt->end){
+						stale.append(d->selectMisspelling(*prevIt));
+					}
+				}
+				if(!wasMisspelled){
+					added.append(cursor);
+				}
+				found.append(TextEditCheckerPrivate::Misspelling{cursor.selectionStart(), cursor.selectionEnd(), word.toString(), false});
+			}
 		}
-		// Go to next word start
-		while(cursor.position() < end && !cursor.isWordChar(cursor.nextChar())){
-			cursor.movePosition(QTextCursor::NextCharacter);
+	}
+	for(; prevIt != previous.cend(); ++prevIt){
+		if(prevIt->start < prevIt->end){
+			stale.append(d->selectMisspelling(*prevIt));
 		}
 	}
+	d->insertMisspellings(found);
+	for(const QTextCursor& c : stale){
+		TextEditCheckerPrivate::removeSpellingFormat(c);
+	}
+	for(QTextCursor& c : added){
+		c.mergeCharFormat(errorFmt);
+	}
 	cursor.endEditBlock();
 
-	d->textEdit->document()->blockSignals(false);
+	d->textEdit->document()->blockSignals(signalsWereBlocked);
 }
 
 bool TextEditCheckerPrivate::noSpellingPropertySet(const QTextCursor &cursor) const
@@ -262,14 +686,33 @@ bool TextEditCheckerPrivate::noSpellingPropertySet(const QTextCursor &cursor) co
 	if(cursor.charFormat().intProperty(noSpellingProperty) == 1) {
 		return true;
 	}
-	const QVector<QTextLayout::FormatRange>& formats = cursor.block().layout()->formats();
-	int pos = cursor.positionInBlock();
-	foreach(const QTextLayout::FormatRange& range, formats) {
-		if(pos > range.start && pos <= range.start + range.length && range.format.intProperty(noSpellingProperty) == 1) {
-			return true;
+	const QVector<QTextLayout::FormatRange> formats = cursor.block().layout()->formats();
+	if(formats.isEmpty()) {
+		return false;
+	}
+	// Formats are implicitly shared: only rebuild the ranges if the block formats changed
+	if(formats.constData() != noSpellingFormats.constData()) {
+		noSpellingFormats = formats;
+		noSpellingRanges.clear();
+		for(const QTextLayout::FormatRange& range : formats) {
+			if(range.format.intProperty(noSpellingProperty) == 1) {
+				noSpellingRanges.append(qMakePair(range.start, range.start + range.length));
+			}
+		}
+		std::sort(noSpellingRanges.begin(), noSpellingRanges.end());
+		int n = 0;
+		for(int i = 0; i < noSpellingRanges.size(); ++i) {
+			if(n > 0 && noSpellingRanges[i].first <= noSpellingRanges[n - 1].second) {
+				noSpellingRanges[n - 1].second = qMax(noSpellingRanges[n - 1].second, noSpellingRanges[i].second);
+			} else {
+				noSpellingRanges[n++] = noSpellingRanges[i];
+			}
 		}
+		noSpellingRanges.resize(n);
 	}
-	return false;
+	int pos = cursor.positionInBlock();
+	auto it = std::lower_bound(noSpellingRanges.cbegin(), noSpellingRanges.cend(), pos, [](const QPair<int, int>& range, int value){ return range.first < value; });
+	return it != noSpellingRanges.cbegin() && pos <= (it - 1)->second;
 }
 
 void TextEditChecker::clearUndoRedo()
@@ -293,11 +736,58 @@ void TextEditChecker::setUndoRedoEnabled(bool enabled)
 		emit redoAvailable(false);
 	}else{
 		d->undoRedoStack = new UndoRedoStack(d->textEdit);
+		d->undoRedoStack->setLimits(d->undoRedoMaxBytes, d->undoRedoMaxSteps);
+		d->undoRedoStack->setJournalThreshold(d->undoRedoJournalThreshold);
 		connect(d->undoRedoStack, &QtSpell::UndoRedoStack::undoAvailable, this, &TextEditChecker::undoAvailable);
 		connect(d->undoRedoStack, &QtSpell::UndoRedoStack::redoAvailable, this, &TextEditChecker::redoAvailable);
 	}
 }
 
+void TextEditChecker::setUndoRedoLimits(qint64 maxBytes, int maxSteps)
+{
+	Q_D(TextEditChecker);
+	d->undoRedoMaxBytes = maxBytes;
+	d->undoRedoMaxSteps = maxSteps;
+	if(d->undoRedoStack){
+		d->undoRedoStack->setLimits(maxBytes, maxSteps);
+	}
+}
+
+void TextEditChecker::setUndoRedoJournalThreshold(int steps)
+{
+	Q_D(TextEditChecker);
+	d->undoRedoJournalThreshold = steps;
+	if(d->undoRedoStack){
+		d->undoRedoStack->setJournalThreshold(steps);
+	}
+}
+
+qint64 TextEditChecker::undoRedoMemoryUsage() const
+{
+	Q_D(const TextEditChecker);
+	return d->undoRedoStack ? d->undoRedoStack->memoryUsage() : 0;
+}
+
+bool TextEditChecker::setEditRecording(const QString& path)
+{
+	Q_D(TextEditChecker);
+	delete d->editRecording;
+	d->editRecording = nullptr;
+	if(path.isEmpty()){
+		return true;
+	}
+	d->editRecording = new QFile(path);
+	if(!d->editRecording->open(QIODevice::WriteOnly | QIODevice::Truncate)){
+		qWarning() << "Failed to open edit recording: " << d->editRecording->errorString();
+		delete d->editRecording;
+		d->editRecording = nullptr;
+		return false;
+	}
+	d->editRecordingTimer.start();
+	d->recordText();
+	return true;
+}
+
 QString TextEditChecker::getWord(int pos, int* start, int* end) const
 {
 	Q_D(const TextEditChecker);
@@ -339,9 +829,12 @@ void TextEditChecker::slotCheckDocumentChanged()
 		if(d->document){
 			disconnect(d->document, &QTextDocument::contentsChange, this, &TextEditChecker::slotCheckRange);
 		}
+		d->clearMisspellings();
+		d->cancelScheduledCheck();
 		d->document = d->textEdit->document();
 		connect(d->document, &QTextDocument::contentsChange, this, &TextEditChecker::slotCheckRange);
 		setUndoRedoEnabled(undoWasEnabled);
+		d->recordText();
 	}
 }
 
@@ -353,6 +846,8 @@ void TextEditChecker::slotDetachTextEdit()
 	delete d->textEdit;
 	d->textEdit = nullptr;
 	d->document = nullptr;
+	d->clearMisspellings();
+	d->cancelScheduledCheck();
 	if(undoWasEnabled){
 		// Crate dummy instance
 		setUndoRedoEnabled(true);
@@ -362,53 +857,125 @@ void TextEditChecker::slotDetachTextEdit()
 void TextEditChecker::slotCheckRange(int pos, int removed, int added)
 {
 	Q_D(TextEditChecker);
-	if(d->undoRedoStack != nullptr && !d->undoRedoInProgress){
-		d->undoRedoStack->handleContentsChange(pos, removed, added);
-	}
-
-	// Qt Bug? Apparently, when contents is pasted at pos = 0, added and removed are too large by 1
 	TextCursor c(d->textEdit->textCursor());
 	c.movePosition(QTextCursor::End);
 	int len = c.position();
+
+	// If a large document was loaded (i.e. via setPlainText or setHtml), don't
+	// record an undo step for it and check it in the background
+	bool bulkLoad = pos == 0 && added >= len && len > BackgroundCheckThreshold;
+
+	// The undo stack also needs to see the changes caused by undo/redo to keep its copy of the text in sync
+	if(d->undoRedoStack != nullptr){
+		if(bulkLoad){
+			d->undoRedoStack->handleDocumentReplaced();
+		}else{
+			d->undoRedoStack->handleContentsChange(pos, removed, added);
+		}
+	}
+
+	// Qt Bug? Apparently, when contents is pasted at pos = 0, added and removed are too large by 1
 	if(pos == 0 && added > len){
 		--added;
+		removed = qMax(0, removed - 1);
 	}
+	if(d->editRecording){
+		d->recordEdit(pos, removed, added);
+	}
+	d->shiftMisspellings(pos, removed, added);
 
-	// Set default format on inserted text
-	c.beginEditBlock();
+	if(bulkLoad){
+		d->clearMisspellings();
+		d->scheduleCheck(0, len);
+		return;
+	}
+
+	// Set default format on inserted text and check it, the range is extended to whole words
 	c.setPosition(pos);
 	c.moveWordStart();
 	c.setPosition(pos + added, QTextCursor::KeepAnchor);
 	c.moveWordEnd(QTextCursor::KeepAnchor);
-	QTextCharFormat fmt = c.charFormat();
-	QTextCharFormat defaultFormat = QTextCharFormat();
-	fmt.setFontUnderline(defaultFormat.fontUnderline());
-	fmt.setUnderlineColor(defaultFormat.underlineColor());
-	fmt.setUnderlineStyle(defaultFormat.underlineStyle());
-	c.setCharFormat(fmt);
-	checkSpelling(c.anchor(), c.position());
-	c.endEditBlock();
+	if(d->checksDeferred){
+		d->deferCheck(c.anchor(), c.position());
+	}else{
+		d->recheckRange(c.anchor(), c.position());
+	}
+
+	// Typed words are corrected, but not the text restored by undo/redo
+	if(d->autoCorrect && !d->checksDeferred && removed == 0 && added == 1){
+		d->autoCorrectWordBefore(pos);
+	}
+}
+
+bool TextEditCheckerPrivate::runBackgroundCheck(int timeBudget)
+{
+	Q_Q(TextEditChecker);
+	if(!textEdit || pendingCheck.isNull()){
+		return false;
+	}
+	// The background check must not flag the document as modified
+	bool wasModified = document->isModified();
+	int start = pendingCheck.selectionStart();
+	int end = pendingCheck.selectionEnd();
+	QElapsedTimer timer;
+	timer.start();
+	while(start < end && timer.elapsed() < timeBudget){
+		// Don't split words between chunks
+		TextCursor c(document);
+		c.setPosition(qMin(start + BackgroundCheckChunkSize, end));
+		if(c.isInsideWord()){
+			c.moveWordEnd();
+		}
+		int chunkEnd = qMax(c.position(), qMin(start + BackgroundCheckChunkSize, end));
+		q->checkSpelling(start, chunkEnd);
+		start = chunkEnd;
+	}
+	document->setModified(wasModified);
+	if(start < end){
+		pendingCheck.setPosition(start);
+		pendingCheck.setPosition(end, QTextCursor::KeepAnchor);
+		return true;
+	}
+	pendingCheck = QTextCursor();
+	return false;
 }
 
 void TextEditChecker::undo()
+{
+	undoSteps(1);
+}
+
+void TextEditChecker::redo()
+{
+	redoSteps(1);
+}
+
+void TextEditChecker::undoSteps(int count)
 {
 	Q_D(TextEditChecker);
 	if(d->undoRedoStack != nullptr){
-		d->undoRedoInProgress = true;
-		d->undoRedoStack->undo();
+		// Apply all steps first, then check the affected text once
+		d->checksDeferred = true;
+		for(int i = 0; i < count; ++i){
+			d->undoRedoStack->undo();
+		}
+		d->checksDeferred = false;
+		d->checkDeferred();
 		d->textEdit->ensureCursorVisible();
-		d->undoRedoInProgress = false;
 	}
 }
 
-void TextEditChecker::redo()
+void TextEditChecker::redoSteps(int count)
 {
 	Q_D(TextEditChecker);
 	if(d->undoRedoStack != nullptr){
-		d->undoRedoInProgress = true;
-		d->undoRedoStack->redo();
+		d->checksDeferred = true;
+		for(int i = 0; i < count; ++i){
+			d->undoRedoStack->redo();
+		}
+		d->checksDeferred = false;
+		d->checkDeferred();
 		d->textEdit->ensureCursorVisible();
-		d->undoRedoInProgress = false;
 	}
 }
 
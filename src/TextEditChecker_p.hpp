@@ -21,15 +21,23 @@
 
 #include "QtSpell.hpp"
 #include "Checker_p.hpp"
+#include "WordChars.hpp"
 
-#include <QRegularExpression>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QTextCursor>
+#include <QTextLayout>
+#include <QTimer>
+#include <QVector>
 
+class QFile;
 class QMenu;
 class QTextDocument;
+class QWidget;
 
 namespace QtSpell {
 
+class CheckerGroupPrivate;
 class TextEditChecker;
 class TextEditProxy;
 class UndoRedoStack;
@@ -37,18 +45,75 @@ class UndoRedoStack;
 class TextEditCheckerPrivate : public CheckerPrivate
 {
 public:
-	TextEditCheckerPrivate();
+	TextEditCheckerPrivate(CheckerGroupPrivate* checkerGroup = nullptr);
 	virtual ~TextEditCheckerPrivate();
 
+	void initLanguage() override;
+	bool setLanguageInternal(const QString& newLang) override;
 	void setTextEdit(TextEditProxy* newTextEdit);
 	bool noSpellingPropertySet(const QTextCursor& cursor) const;
+	void recheckWord(const QString& word, int start, int end) override;
+	void clearMisspelledWord(const QString& word);
 
+	/**
+	 * @brief A misspelled word. Plain positions are used rather than cursors,
+	 *        as the document would need to update every cursor on each edit.
+	 *        The positions are shifted in shiftMisspellings() instead.
+	 */
+	struct Misspelling {
+		int start;
+		int end;
+		QString word;
+		// Whether the word became correct, see clearMisspelledWord()
+		bool cleared;
+	};
+
+	void scheduleCheck(int start, int end);
+	void cancelScheduledCheck();
+	void recheckAll() override;
+	void recheckAllSharingDictionary() override;
+	bool runBackgroundCheck(int timeBudget);
+	void recheckRange(int start, int end);
+	void autoCorrectWordBefore(int pos);
+	void deferCheck(int start, int end);
+	void checkDeferred();
+
+	void insertMisspellings(const QVector<Misspelling>& found);
+	QVector<Misspelling> takeMisspellings(int start, int end);
+	void shiftMisspellings(int pos, int removed, int added);
+	void clearMisspellings();
+	void removeFromIndex(Misspelling* misspelling);
+	QTextCursor selectMisspelling(const Misspelling& misspelling) const;
+	static void removeSpellingFormat(const QTextCursor& cursor);
+	void recordText();
+	void recordEdit(int pos, int removed, int added);
+
+	// The group the checker belongs to, which provides the dictionary
+	CheckerGroupPrivate* group = nullptr;
 	TextEditProxy* textEdit = nullptr;
 	QTextDocument* document = nullptr;
 	UndoRedoStack* undoRedoStack = nullptr;
-	bool undoRedoInProgress = false;
+	qint64 undoRedoMaxBytes = -1;
+	int undoRedoMaxSteps = -1;
+	int undoRedoJournalThreshold = -1;
 	Qt::ContextMenuPolicy oldContextMenuPolicy;
 	int noSpellingProperty = -1;
+	// The no-spelling ranges (sorted and merged) of the block formats last queried in noSpellingPropertySet
+	mutable QVector<QTextLayout::FormatRange> noSpellingFormats;
+	mutable QVector<QPair<int, int>> noSpellingRanges;
+	// The range still to be checked in the background, by the IdleScheduler
+	QTextCursor pendingCheck;
+	// While a batch of undo/redo steps is applied, the range affected by the steps, checked once the batch is complete
+	bool checksDeferred = false;
+	QTextCursor deferredCheck;
+	// The misspelled words of the document, sorted by position, and the number of those flagged as cleared
+	QVector<Misspelling*> misspellings;
+	int clearedMisspellings = 0;
+	// Maps each misspelled word to all its occurrences
+	QHash<QString, QVector<Misspelling*>> misspellingIndex;
+	// The file the edits are recorded to, see TextEditChecker::setEditRecording
+	QFile* editRecording = nullptr;
+	QElapsedTimer editRecordingTimer;
 
 	Q_DECLARE_PUBLIC(TextEditChecker)
 };
@@ -60,13 +125,13 @@ class TextCursor : public QTextCursor
 {
 public:
 	TextCursor()
-		: QTextCursor(), m_wordRegEx(QRegularExpression("^\\w$")) {}
+		: QTextCursor() {}
 	TextCursor(QTextDocument* document)
-		: QTextCursor(document), m_wordRegEx(QRegularExpression("^\\w$")) {}
+		: QTextCursor(document) {}
 	TextCursor(const QTextBlock& block)
-		: QTextCursor(block), m_wordRegEx(QRegularExpression("^\\w$")) {}
+		: QTextCursor(block) {}
 	TextCursor(const QTextCursor& cursor)
-		: QTextCursor(cursor), m_wordRegEx(QRegularExpression("^\\w$")) {}
+		: QTextCursor(cursor) {}
 
 	/**
 	 * @brief Retreive the num-th next character.
@@ -101,7 +166,7 @@ public:
 	 * @return Whether the cursor is inside a word.
 	 */
 	bool isInsideWord() const{
-		return nextChar().contains(m_wordRegEx) || prevChar().contains(m_wordRegEx);
+		return WordChars::isWordChar(nextChar()) || WordChars::isWordChar(prevChar());
 	}
 
 	/**
@@ -109,11 +174,8 @@ public:
 	 * @return Whether the specified character is a word character.
 	 */
 	bool isWordChar(const QString& character) const{
-		return character.contains(m_wordRegEx);
+		return WordChars::isWordChar(character);
 	}
-
-private:
-	QRegularExpression m_wordRegEx;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -124,6 +186,7 @@ public:
 	TextEditProxy(QObject* parent = nullptr) : QObject(parent) {}
 	virtual QTextCursor textCursor() const = 0;
 	virtual QTextDocument* document() const = 0;
+	virtual QWidget* widget() const = 0;
 	virtual QPoint mapToGlobal(const QPoint& pos) const = 0;
 	virtual QMenu* createStandardContextMenu() = 0;
 	virtual QTextCursor cursorForPosition(const QPoint& pos) const = 0;
@@ -150,6 +213,7 @@ public:
 	}
 	QTextCursor textCursor() const{ return m_textEdit->textCursor(); }
 	QTextDocument* document() const{ return m_textEdit->document(); }
+	QWidget* widget() const{ return m_textEdit; }
 	QPoint mapToGlobal(const QPoint& pos) const{ return m_textEdit->mapToGlobal(pos); }
 	QMenu* createStandardContextMenu(){ return m_textEdit->createStandardContextMenu(); }
 	QTextCursor cursorForPosition(const QPoint& pos) const{ return m_textEdit->cursorForPosition(pos); }
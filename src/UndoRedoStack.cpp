@@ -18,67 +18,275 @@
 
 #include "UndoRedoStack.hpp"
 #include "TextEditChecker_p.hpp"
+#include <QDir>
+#include <QTemporaryFile>
 #include <QTextDocument>
+#include <QtDebug>
+#include <algorithm>
+#include <cstring>
 
 namespace QtSpell {
 
-struct UndoRedoStack::Action {
-	virtual ~Action(){}
-};
-
-struct UndoRedoStack::UndoableInsert : public UndoRedoStack::Action {
-	QString text;
-	int pos;
-	bool isWhitespace;
-	bool isMergeable;
-
-	UndoableInsert(int _pos, const QString& _text){
-		pos = _pos;
-		text = _text;
-		isWhitespace = text.length() == 1 && text[0].isSpace();
-		isMergeable = (text.length() == 1);
-	}
-};
-
-struct UndoRedoStack::UndoableDelete : public UndoRedoStack::Action {
-	QString text;
-	int start, end;
-	bool deleteKeyUsed;
-	bool isWhitespace;
-	bool isMergeable;
-
-	UndoableDelete(int _start, int _end, const QString& _text, bool _deleteKeyUsed){
-		start = _start;
-		end = _end;
-		text = _text;
-		deleteKeyUsed = _deleteKeyUsed;
-		isWhitespace = text.length() == 1 && text[0].isSpace();
-		isMergeable = (text.length() == 1);
-	}
-};
-
 UndoRedoStack::UndoRedoStack(TextEditProxy* textEdit)
 	: m_textEdit(textEdit)
 {
-	// We need to keep undo/redo enabled to retreive the deleted text in onContentsChange...
 	if(m_textEdit){
-		m_textEdit->document()->setUndoRedoEnabled(true);
+		// The removed text is retreived from the shadow copy of the text, so the
+		// undo stack of the document is not needed (and would record the spelling
+		// format changes)
+		m_document = m_textEdit->document();
+		m_documentUndoWasEnabled = m_document->isUndoRedoEnabled();
+		m_document->setUndoRedoEnabled(false);
+		resetText();
+	}
+}
+
+UndoRedoStack::~UndoRedoStack()
+{
+	delete m_journal;
+	if(m_document){
+		m_document->setUndoRedoEnabled(m_documentUndoWasEnabled);
 	}
 }
 
 void UndoRedoStack::clear()
 {
-	qDeleteAll(m_undoStack);
-	qDeleteAll(m_redoStack);
 	m_undoStack.clear();
+	m_undoBase = 0;
 	m_redoStack.clear();
+	m_actionText.clear();
+	m_actionTextGarbage = 0;
+	m_memoryUsage = 0;
+	clearJournal();
 	emit undoAvailable(false);
 	emit redoAvailable(false);
 }
 
+void UndoRedoStack::setLimits(qint64 maxBytes, int maxSteps)
+{
+	m_maxBytes = maxBytes;
+	m_maxSteps = maxSteps;
+	enforceLimits();
+	emit undoAvailable(undoCount() > 0 || !m_journalBatches.isEmpty());
+}
+
+void UndoRedoStack::setJournalThreshold(int steps)
+{
+	// Keep at least one step in memory, so that it can be merged with new actions
+	m_journalThreshold = steps < 0 ? -1 : qMax(1, steps);
+	enforceLimits();
+}
+
+UndoRedoStack::Action UndoRedoStack::makeAction(Action::Type type, int start, int end, const QChar* text, int length) const
+{
+	Action action;
+	action.type = type;
+	action.start = start;
+	action.end = end;
+	action.textOffset = -1;
+	action.textLength = length;
+	action.deleteKeyUsed = false;
+	action.isWhitespace = length == 1 && text[0].isSpace();
+	action.isMergeable = length == 1;
+	action.isReversed = false;
+	return action;
+}
+
+void UndoRedoStack::pushAction(Action action, const QChar* text)
+{
+	action.textOffset = m_actionText.length();
+	m_actionText.append(text, action.textLength);
+	m_memoryUsage += sizeof(Action) + action.textLength * sizeof(QChar);
+	m_undoStack.append(action);
+}
+
+QString UndoRedoStack::actionText(const Action& action) const
+{
+	QString text = m_actionText.mid(action.textOffset, action.textLength);
+	if(action.isReversed){
+		std::reverse(text.begin(), text.end());
+	}
+	return text;
+}
+
+void UndoRedoStack::appendActionText(Action& action, const QChar* text, int length)
+{
+	if(action.textOffset + action.textLength != m_actionText.length()){
+		// Not at the end of the buffer, move the text of the action there first
+		m_actionText.reserve(m_actionText.length() + action.textLength + length);
+		int offset = m_actionText.length();
+		m_actionText.append(m_actionText.constData() + action.textOffset, action.textLength);
+		m_actionTextGarbage += action.textLength;
+		action.textOffset = offset;
+	}
+	m_actionText.append(text, length);
+	action.textLength += length;
+	m_memoryUsage += length * sizeof(QChar);
+}
+
+void UndoRedoStack::prependActionText(Action& action, const QChar* text, int length)
+{
+	// The text is kept reversed, so that prepending is appending rather than copying the whole text each time
+	if(!action.isReversed){
+		// Only actions holding a single character are merged with the backspace key first, which reversed are the same
+		Q_ASSERT(action.textLength <= 1);
+		action.isReversed = true;
+	}
+	QString reversed(text, length);
+	std::reverse(reversed.begin(), reversed.end());
+	appendActionText(action, reversed.constData(), length);
+}
+
+void UndoRedoStack::discardAction(const Action& action)
+{
+	m_actionTextGarbage += action.textLength;
+	m_memoryUsage -= sizeof(Action) + action.textLength * sizeof(QChar);
+}
+
+void UndoRedoStack::clearRedoStack()
+{
+	for(const Action& action : m_redoStack){
+		discardAction(action);
+	}
+	m_redoStack.resize(0);
+}
+
+void UndoRedoStack::enforceLimits()
+{
+	// Move the oldest undo steps to the journal, in batches
+	if(m_journalThreshold >= 0 && undoCount() > 2 * m_journalThreshold){
+		writeJournal(undoCount() - m_journalThreshold);
+	}
+	// Discard the oldest undo steps until the history fits the limits again
+	while(undoCount() > 0 &&
+		  ((m_maxBytes >= 0 && m_memoryUsage > m_maxBytes) ||
+		   (m_maxSteps >= 0 && undoCount() + m_redoStack.size() > m_maxSteps))){
+		// The journal contains steps which are older still, they can't be undone anymore either
+		clearJournal();
+		discardAction(m_undoStack[m_undoBase++]);
+	}
+	compact(false);
+	// The unreferenced text counts towards the limit as well. Before compacting the text to get rid of it, the
+	// history is trimmed to three quarters of the limit, so that the text isn't compacted again on every edit.
+	if(m_maxBytes >= 0 && memoryUsage() > m_maxBytes){
+		while(undoCount() > 0 && m_memoryUsage > m_maxBytes / 4 * 3){
+			clearJournal();
+			discardAction(m_undoStack[m_undoBase++]);
+		}
+		compact(true);
+	}
+}
+
+void UndoRedoStack::compact(bool force)
+{
+	if(m_undoBase > 0 && m_undoBase >= m_undoStack.size() / 2){
+		m_undoStack.remove(0, m_undoBase);
+		m_undoBase = 0;
+	}
+	if(m_actionTextGarbage > 0 && (force || (m_actionTextGarbage > 4096 && m_actionTextGarbage > m_actionText.length() / 2))){
+		QString text;
+		text.reserve(m_actionText.length() - m_actionTextGarbage);
+		for(QVector<Action>* stack : {&m_undoStack, &m_redoStack}){
+			for(int i = stack == &m_undoStack ? m_undoBase : 0, n = stack->size(); i < n; ++i){
+				Action& action = (*stack)[i];
+				int offset = text.length();
+				text.append(m_actionText.constData() + action.textOffset, action.textLength);
+				action.textOffset = offset;
+			}
+		}
+		m_actionText = text;
+		m_actionTextGarbage = 0;
+	}
+}
+
+void UndoRedoStack::writeJournal(int count)
+{
+	if(!m_journal){
+		m_journal = new QTemporaryFile(QDir::tempPath() + "/qtspell-undo-XXXXXX");
+		if(!m_journal->open()){
+			qWarning() << "Failed to create undo journal: " << m_journal->errorString();
+			delete m_journal;
+			m_journal = nullptr;
+			m_journalThreshold = -1;
+			return;
+		}
+	}
+	// Batch layout: number of steps, then for each step the action record followed by its text
+	QByteArray batch;
+	batch.append(reinterpret_cast<const char*>(&count), sizeof(count));
+	for(int i = 0; i < count; ++i){
+		const Action& action = m_undoStack[m_undoBase + i];
+		batch.append(reinterpret_cast<const char*>(&action), sizeof(Action));
+		batch.append(reinterpret_cast<const char*>(m_actionText.constData() + action.textOffset), action.textLength * sizeof(QChar));
+	}
+	if(!m_journal->seek(m_journalEnd) || m_journal->write(batch) != batch.size() || !m_journal->flush()){
+		// Keep the steps in memory from now on, rather than failing again on every edit
+		qWarning() << "Failed to write undo journal, keeping the undo history in memory: " << m_journal->errorString();
+		m_journal->resize(m_journalEnd);
+		m_journalThreshold = -1;
+		return;
+	}
+	m_journalBatches.append(m_journalEnd);
+	m_journalEnd += batch.size();
+	for(int i = 0; i < count; ++i){
+		discardAction(m_undoStack[m_undoBase++]);
+	}
+}
+
+void UndoRedoStack::readJournal()
+{
+	// Map the most recent batch and move its steps back into memory
+	qint64 offset = m_journalBatches.last();
+	uchar* data = m_journal->map(offset, m_journalEnd - offset);
+	if(!data){
+		qWarning() << "Failed to map undo journal: " << m_journal->errorString();
+		clearJournal();
+		return;
+	}
+	const uchar* pos = data;
+	int count;
+	std::memcpy(&count, pos, sizeof(count));
+	pos += sizeof(count);
+	QVector<Action> actions;
+	actions.reserve(count + undoCount());
+	for(int i = 0; i < count; ++i){
+		Action action;
+		std::memcpy(&action, pos, sizeof(Action));
+		pos += sizeof(Action);
+		action.textOffset = m_actionText.length();
+		m_actionText.append(reinterpret_cast<const QChar*>(pos), action.textLength);
+		pos += action.textLength * sizeof(QChar);
+		m_memoryUsage += sizeof(Action) + action.textLength * sizeof(QChar);
+		actions.append(action);
+	}
+	m_journal->unmap(data);
+	for(int i = m_undoBase, n = m_undoStack.size(); i < n; ++i){
+		actions.append(m_undoStack[i]);
+	}
+	m_undoStack = actions;
+	m_undoBase = 0;
+	m_journalBatches.removeLast();
+	m_journalEnd = offset;
+}
+
+void UndoRedoStack::clearJournal()
+{
+	if(m_journal && !m_journalBatches.isEmpty()){
+		m_journal->resize(0);
+	}
+	m_journalBatches.clear();
+	m_journalEnd = 0;
+}
+
+void UndoRedoStack::handleDocumentReplaced()
+{
+	clear();
+	resetText();
+}
+
 void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 {
-	if(m_actionInProgress || (added == 0 && removed == 0)){
+	if(added == 0 && removed == 0){
 		return;
 	}
 	// Qt Bug? Apparently, when contents is pasted at pos = 0, added and removed are too large by 1
@@ -87,82 +295,89 @@ void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 	int len = c.position();
 	if(pos == 0 && added > len){
 		--added;
-		--removed;
+		removed = qMax(0, removed - 1);
+	}
+	if(pos + removed > textLength()){
+		// Should not happen, but in case the shadow text is out of sync, give up
+		handleDocumentReplaced();
+		return;
+	}
+	if(!m_actionInProgress){
+		clearRedoStack();
 	}
-	qDeleteAll(m_redoStack);
-	m_redoStack.clear();
 	if(removed > 0){
-		m_textEdit->document()->undo();
-		bool deleteWasUsed = (c.anchor() == c.position() && c.position() == pos);
-		c.setPosition(pos);
-		c.setPosition(pos + removed, QTextCursor::KeepAnchor);
-		UndoableDelete* undoAction = new UndoableDelete(pos, pos + removed, c.selectedText(), deleteWasUsed);
-		m_textEdit->document()->redo();
-		if(m_undoStack.empty() || !dynamic_cast<UndoableDelete*>(m_undoStack.top())){
-			m_undoStack.push(undoAction);
-		}else{
-			UndoableDelete* prevDelete = static_cast<UndoableDelete*>(m_undoStack.top());
-			if(deleteMergeable(prevDelete, undoAction)){
-				if(prevDelete->start == undoAction->start){ // Delete key used
-					prevDelete->text += undoAction->text;
-					prevDelete->end += (undoAction->end - undoAction->start);
+		moveGap(pos);
+		if(!m_actionInProgress){
+			const QChar* removedText = m_text.constData() + m_gapEnd;
+			Action undoAction = makeAction(Action::Delete, pos, pos + removed, removedText, removed);
+			Action* prevDelete = undoCount() > 0 && m_undoStack.last().type == Action::Delete ? &m_undoStack.last() : nullptr;
+			if(prevDelete && deleteMergeable(*prevDelete, undoAction)){
+				if(prevDelete->start == undoAction.start){ // Delete key used
+					appendActionText(*prevDelete, removedText, removed);
+					prevDelete->end += removed;
+					prevDelete->deleteKeyUsed = true;
 				}else{ // Backspace used
-					prevDelete->text = undoAction->text + prevDelete->text;
-					prevDelete->start = undoAction->start;
+					prependActionText(*prevDelete, removedText, removed);
+					prevDelete->start = undoAction.start;
 				}
 			}else{
-				m_undoStack.push(undoAction);
+				pushAction(undoAction, removedText);
 			}
 		}
+		m_gapEnd += removed;
 	}
 	if(added > 0){
-		QTextCursor c(m_textEdit->textCursor());
 		c.setPosition(pos);
 		c.setPosition(pos + added, QTextCursor::KeepAnchor);
-		UndoableInsert* undoAction = new UndoableInsert(pos, c.selectedText());
-		if(m_undoStack.empty() || !dynamic_cast<UndoableInsert*>(m_undoStack.top())){
-			m_undoStack.push(undoAction);
-		}else{
-			UndoableInsert* prevInsert = static_cast<UndoableInsert*>(m_undoStack.top());
-			if(insertMergeable(prevInsert, undoAction)){
-				prevInsert->text += undoAction->text;
+		QString addedText = c.selectedText();
+		putText(pos, addedText);
+		if(!m_actionInProgress){
+			Action undoAction = makeAction(Action::Insert, pos, pos + added, addedText.constData(), added);
+			Action* prevInsert = undoCount() > 0 && m_undoStack.last().type == Action::Insert ? &m_undoStack.last() : nullptr;
+			if(prevInsert && insertMergeable(*prevInsert, undoAction)){
+				appendActionText(*prevInsert, addedText.constData(), added);
+				prevInsert->end += added;
 			}else{
-				m_undoStack.push(undoAction);
+				pushAction(undoAction, addedText.constData());
 			}
 		}
 	}
-	// We are only interested in the previous step for delete, no point in storing the rest
-	if(added > 0 || removed > 0){
-		m_textEdit->document()->clearUndoRedoStacks();
+	if(textLength() != len){
+		resetText();
+	}
+	if(m_actionInProgress){
+		return;
 	}
+	enforceLimits();
 	emit redoAvailable(false);
-	emit undoAvailable(true);
+	emit undoAvailable(undoCount() > 0 || !m_journalBatches.isEmpty());
 }
 
 void UndoRedoStack::undo()
 {
-	if(m_undoStack.empty()){
+	if(undoCount() == 0 && !m_journalBatches.isEmpty()){
+		readJournal();
+	}
+	if(undoCount() == 0){
 		return;
 	}
 	m_actionInProgress = true;
-	Action* undoAction = m_undoStack.pop();
-	m_redoStack.push(undoAction);
+	Action undoAction = m_undoStack.takeLast();
+	m_redoStack.append(undoAction);
 	QTextCursor c(m_textEdit->textCursor());
-	if(dynamic_cast<UndoableInsert*>(undoAction)){
-		UndoableInsert* insertAction = static_cast<UndoableInsert*>(undoAction);
-		c.setPosition(insertAction->pos);
-		c.setPosition(insertAction->pos + insertAction->text.length(), QTextCursor::KeepAnchor);
+	if(undoAction.type == Action::Insert){
+		c.setPosition(undoAction.start);
+		c.setPosition(undoAction.start + undoAction.textLength, QTextCursor::KeepAnchor);
 		c.removeSelectedText();
 	}else{
-		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(undoAction);
-		c.setPosition(deleteAction->start);
-		c.insertText(deleteAction->text);
-		if(deleteAction->deleteKeyUsed){
-			c.setPosition(deleteAction->start);
+		c.setPosition(undoAction.start);
+		c.insertText(actionText(undoAction));
+		if(undoAction.deleteKeyUsed){
+			c.setPosition(undoAction.start);
 		}
 	}
 	m_textEdit->setTextCursor(c);
-	emit undoAvailable(!m_undoStack.empty());
+	emit undoAvailable(undoCount() > 0 || !m_journalBatches.isEmpty());
 	emit redoAvailable(!m_redoStack.empty());
 	m_actionInProgress = false;
 }
@@ -173,39 +388,80 @@ void UndoRedoStack::redo()
 		return;
 	}
 	m_actionInProgress = true;
-	Action* redoAction = m_redoStack.top();
-	m_redoStack.pop();
-	m_undoStack.push(redoAction);
+	Action redoAction = m_redoStack.takeLast();
+	m_undoStack.append(redoAction);
 	QTextCursor c(m_textEdit->textCursor());
-	if(dynamic_cast<UndoableInsert*>(redoAction)){
-		UndoableInsert* insertAction = static_cast<UndoableInsert*>(redoAction);
-		c.setPosition(insertAction->pos);
-		c.insertText(insertAction->text);
+	if(redoAction.type == Action::Insert){
+		c.setPosition(redoAction.start);
+		c.insertText(actionText(redoAction));
 	}else{
-		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(redoAction);
-		c.setPosition(deleteAction->start);
-		c.setPosition(deleteAction->end, QTextCursor::KeepAnchor);
+		c.setPosition(redoAction.start);
+		c.setPosition(redoAction.end, QTextCursor::KeepAnchor);
 		c.removeSelectedText();
 	}
 	m_textEdit->setTextCursor(c);
-	emit undoAvailable(!m_undoStack.empty());
+	emit undoAvailable(undoCount() > 0 || !m_journalBatches.isEmpty());
 	emit redoAvailable(!m_redoStack.empty());
 	m_actionInProgress = false;
 }
 
-bool UndoRedoStack::insertMergeable(const UndoableInsert* prev, const UndoableInsert* cur) const
+bool UndoRedoStack::insertMergeable(const Action& prev, const Action& cur) const
 {
-	return (cur->pos == prev->pos + prev->text.length()) &&
-		   (cur->isWhitespace == prev->isWhitespace) &&
-		   (cur->isMergeable && prev->isMergeable);
+	return (cur.start == prev.start + prev.textLength) &&
+		   (cur.isWhitespace == prev.isWhitespace) &&
+		   (cur.isMergeable && prev.isMergeable);
 }
 
-bool UndoRedoStack::deleteMergeable(const UndoableDelete* prev, const UndoableDelete* cur) const
+bool UndoRedoStack::deleteMergeable(const Action& prev, const Action& cur) const
 {
-	return (prev->deleteKeyUsed == cur->deleteKeyUsed) &&
-		   (cur->isWhitespace == prev->isWhitespace) &&
-		   (cur->isMergeable && prev->isMergeable) &&
-		   (prev->start == cur->start || prev->start == cur->end);
+	// Don't mix deletions using the delete key (same start) and backspace (adjacent end)
+	bool deleteKey = prev.start == cur.start && (prev.deleteKeyUsed || prev.textLength == 1);
+	bool backspace = prev.start == cur.end && !prev.deleteKeyUsed;
+	return (cur.isWhitespace == prev.isWhitespace) &&
+		   (cur.isMergeable && prev.isMergeable) &&
+		   (deleteKey || backspace);
+}
+
+void UndoRedoStack::resetText()
+{
+	QTextCursor c(m_textEdit->textCursor());
+	c.movePosition(QTextCursor::Start);
+	c.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+	m_text = c.selectedText();
+	m_gapStart = m_gapEnd = m_text.length();
+}
+
+void UndoRedoStack::moveGap(int pos)
+{
+	QChar* data = m_text.data();
+	if(pos < m_gapStart){
+		int count = m_gapStart - pos;
+		std::memmove(data + m_gapEnd - count, data + pos, count * sizeof(QChar));
+		m_gapStart -= count;
+		m_gapEnd -= count;
+	}else if(pos > m_gapStart){
+		int count = pos - m_gapStart;
+		std::memmove(data + m_gapStart, data + m_gapEnd, count * sizeof(QChar));
+		m_gapStart += count;
+		m_gapEnd += count;
+	}
+}
+
+void UndoRedoStack::putText(int pos, const QString& text)
+{
+	moveGap(pos);
+	if(m_gapEnd - m_gapStart < text.length()){
+		// Grow the gap proportionally to the text length
+		int length = textLength();
+		int gap = text.length() + qMax(length / 8, 1024);
+		QString buffer(length + gap, Qt::Uninitialized);
+		std::memcpy(buffer.data(), m_text.constData(), m_gapStart * sizeof(QChar));
+		std::memcpy(buffer.data() + m_gapStart + gap, m_text.constData() + m_gapEnd, (m_text.length() - m_gapEnd) * sizeof(QChar));
+		m_text = buffer;
+		m_gapEnd = m_gapStart + gap;
+	}
+	std::memcpy(m_text.data() + m_gapStart, text.constData(), text.length() * sizeof(QChar));
+	m_gapStart += text.length();
 }
 
 } // QtSpell
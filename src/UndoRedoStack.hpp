@@ -20,9 +20,13 @@
 #define QTSPELL_UNDOREDOSTACK_HPP
 
 #include <QObject>
-#include <QStack>
+#include <QPointer>
+#include <QVector>
 
 
+class QTemporaryFile;
+class QTextDocument;
+
 namespace QtSpell {
 
 class TextEditProxy;
@@ -32,8 +36,13 @@ class UndoRedoStack : public QObject
 	Q_OBJECT
 public:
 	UndoRedoStack(TextEditProxy* textEdit);
+	~UndoRedoStack();
 	void handleContentsChange(int pos, int removed, int added);
+	void handleDocumentReplaced();
 	void clear();
+	void setLimits(qint64 maxBytes, int maxSteps);
+	void setJournalThreshold(int steps);
+	qint64 memoryUsage() const{ return m_memoryUsage + m_actionTextGarbage * qint64(sizeof(QChar)); }
 
 public slots:
 	void undo();
@@ -44,17 +53,69 @@ signals:
 	void redoAvailable(bool);
 
 private:
-	struct Action;
-	struct UndoableInsert;
-	struct UndoableDelete;
+	/**
+	 * @brief An undoable action. The text of the action is stored in the
+	 *        shared m_actionText buffer, reversed for deletions merged with
+	 *        the backspace key so that merging only appends to it.
+	 */
+	struct Action {
+		enum Type : quint8 { Insert, Delete };
+		int start;
+		int end;
+		int textOffset;
+		int textLength;
+		Type type;
+		bool deleteKeyUsed;
+		bool isWhitespace;
+		bool isMergeable;
+		bool isReversed;
+	};
 
 	bool m_actionInProgress = false;
 	TextEditProxy* m_textEdit = nullptr;
-	QStack<Action*> m_undoStack;
-	QStack<Action*> m_redoStack;
+	QPointer<QTextDocument> m_document;
+	bool m_documentUndoWasEnabled = false;
+	// The undo stack, the entries below m_undoBase were discarded
+	QVector<Action> m_undoStack;
+	int m_undoBase = 0;
+	QVector<Action> m_redoStack;
+	// Append-only buffer holding the text of all actions, and the number of unreferenced characters in it
+	QString m_actionText;
+	int m_actionTextGarbage = 0;
+	qint64 m_memoryUsage = 0;
+	qint64 m_maxBytes = -1;
+	int m_maxSteps = -1;
+	// Journal file to which the oldest undo steps are moved, and the offsets of the batches of steps written to it
+	QTemporaryFile* m_journal = nullptr;
+	QVector<qint64> m_journalBatches;
+	qint64 m_journalEnd = 0;
+	int m_journalThreshold = -1;
+
+	// Shadow copy of the document text, stored as a gap buffer, from which the removed text is retreived
+	QString m_text;
+	int m_gapStart = 0;
+	int m_gapEnd = 0;
+
+	int undoCount() const{ return m_undoStack.size() - m_undoBase; }
+	Action makeAction(Action::Type type, int start, int end, const QChar* text, int length) const;
+	void pushAction(Action action, const QChar* text);
+	QString actionText(const Action& action) const;
+	void appendActionText(Action& action, const QChar* text, int length);
+	void prependActionText(Action& action, const QChar* text, int length);
+	bool insertMergeable(const Action& prev, const Action& cur) const;
+	bool deleteMergeable(const Action& prev, const Action& cur) const;
+	void discardAction(const Action& action);
+	void clearRedoStack();
+	void enforceLimits();
+	void compact(bool force);
+	void writeJournal(int count);
+	void readJournal();
+	void clearJournal();
 
-	bool insertMergeable(const UndoableInsert* prev, const UndoableInsert* cur) const;
-	bool deleteMergeable(const UndoableDelete* prev, const UndoableDelete* cur) const;
+	void resetText();
+	int textLength() const{ return m_text.length() - (m_gapEnd - m_gapStart); }
+	void moveGap(int pos);
+	void putText(int pos, const QString& text);
 };
 
 } // QtSpell
@@ -0,0 +1,131 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "WordChars.hpp"
+#include <QtAlgorithms>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace QtSpell {
+
+const Latin1WordTable WordChars::s_latin1 = Latin1WordTable();
+
+#if defined(__AVX2__)
+
+// Returns a bit mask with two bits per UTF-16 unit, set for the ASCII word characters, and whether all units are ASCII
+static inline bool asciiWordMask(const QChar* text, quint32& mask)
+{
+	__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+	// Signed comparisons: units >= 0x8000 are negative and fail the range checks below
+	__m256i nonAscii = _mm256_or_si256(_mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7F)), _mm256_cmpgt_epi16(_mm256_setzero_si256(), v));
+	if(_mm256_movemask_epi8(nonAscii) != 0){
+		return false;
+	}
+	auto inRange = [&v](short lo, short hi){
+		return _mm256_and_si256(_mm256_cmpgt_epi16(v, _mm256_set1_epi16(lo - 1)), _mm256_cmpgt_epi16(_mm256_set1_epi16(hi + 1), v));
+	};
+	__m256i word = _mm256_or_si256(_mm256_or_si256(inRange('0', '9'), inRange('A', 'Z')),
+								   _mm256_or_si256(inRange('a', 'z'), _mm256_cmpeq_epi16(v, _mm256_set1_epi16('_'))));
+	mask = quint32(_mm256_movemask_epi8(word));
+	return true;
+}
+static const int SimdWidth = 16;
+
+#elif defined(__SSE2__)
+
+static inline bool asciiWordMask(const QChar* text, quint32& mask)
+{
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+	// Signed comparisons: units >= 0x8000 are negative and fail the range checks below
+	__m128i nonAscii = _mm_or_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(0x7F)), _mm_cmplt_epi16(v, _mm_setzero_si128()));
+	if(_mm_movemask_epi8(nonAscii) != 0){
+		return false;
+	}
+	auto inRange = [&v](short lo, short hi){
+		return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(lo - 1)), _mm_cmplt_epi16(v, _mm_set1_epi16(hi + 1)));
+	};
+	__m128i word = _mm_or_si128(_mm_or_si128(inRange('0', '9'), inRange('A', 'Z')),
+								_mm_or_si128(inRange('a', 'z'), _mm_cmpeq_epi16(v, _mm_set1_epi16('_'))));
+	mask = quint32(_mm_movemask_epi8(word));
+	return true;
+}
+static const int SimdWidth = 8;
+
+#endif
+
+int WordChars::scanScalar(const QChar* text, int pos, int end, int length, bool word)
+{
+	while(pos < end){
+		uint ucs4 = text[pos].unicode();
+		int width = 1;
+		if(text[pos].isHighSurrogate() && pos + 1 < length && text[pos + 1].isLowSurrogate()){
+			ucs4 = QChar::surrogateToUcs4(text[pos], text[pos + 1]);
+			width = 2;
+		}
+		if(isWordChar(ucs4) != word){
+			break;
+		}
+		pos += width;
+	}
+	return pos;
+}
+
+int WordChars::scan(const QChar* text, int length, bool word)
+{
+	int pos = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+	// Scan ASCII runs a vector at a time, and handle blocks containing other characters one character at a time
+	const quint32 full = SimdWidth == 16 ? 0xFFFFFFFFu : 0xFFFFu;
+	while(pos + SimdWidth <= length){
+		quint32 mask;
+		if(!asciiWordMask(text + pos, mask)){
+			// A surrogate pair may straddle the block boundary, so end can be past the block
+			int end = scanScalar(text, pos, pos + SimdWidth, length, word);
+			if(end < pos + SimdWidth){
+				return end;
+			}
+			pos = end;
+			continue;
+		}
+		if(!word){
+			mask = ~mask & full;
+		}
+		if(mask != full){
+			return pos + qCountTrailingZeroBits(~mask & full) / 2;
+		}
+		pos += SimdWidth;
+	}
+#endif
+	return scanScalar(text, pos, length, length, word);
+}
+
+int WordChars::skipWordChars(const QChar* text, int length)
+{
+	return scan(text, length, true);
+}
+
+int WordChars::skipNonWordChars(const QChar* text, int length)
+{
+	return scan(text, length, false);
+}
+
+} // QtSpell
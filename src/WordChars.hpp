@@ -0,0 +1,105 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_WORDCHARS_HPP
+#define QTSPELL_WORDCHARS_HPP
+
+#include <QChar>
+#include <QStringView>
+
+namespace QtSpell {
+
+/**
+ * @brief Table of the word characters among the Latin-1 characters,
+ *        generated at compile time.
+ */
+struct Latin1WordTable {
+	bool isWord[256];
+	constexpr Latin1WordTable() : isWord() {
+		for(int c = 0; c < 256; ++c){
+			isWord[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' ||
+						c == 0xAA || c == 0xB2 || c == 0xB3 || c == 0xB5 || c == 0xB9 || c == 0xBA || (c >= 0xBC && c <= 0xBE) ||
+						(c >= 0xC0 && c <= 0xFF && c != 0xD7 && c != 0xF7);
+		}
+	}
+};
+
+/**
+ * @brief Classification of word characters: unicode letters, numbers and
+ *        connector punctuation such as the underscore. Unlike the \\w class
+ *        of QRegularExpression without UseUnicodePropertiesOption, which
+ *        only matches ASCII characters, accented and non-latin letters are
+ *        word characters. Combining marks are not.
+ */
+class WordChars
+{
+public:
+	/**
+	 * @brief Returns whether the specified code point is a word character.
+	 * @param ucs4 A unicode code point.
+	 * @return Whether the code point is a word character.
+	 */
+	static bool isWordChar(uint ucs4){
+		return ucs4 < 256 ? s_latin1.isWord[ucs4] : (QChar::isLetterOrNumber(ucs4) || QChar::category(ucs4) == QChar::Punctuation_Connector);
+	}
+
+	/**
+	 * @brief Returns whether the first character of the specified string is
+	 *        a word character.
+	 * @param character A string containing a character, possibly made up of
+	 *        a surrogate pair.
+	 * @return Whether the character is a word character, false if the string
+	 *         is empty.
+	 */
+	static bool isWordChar(QStringView character){
+		if(character.isEmpty()){
+			return false;
+		}
+		QChar ch = character.at(0);
+		if(ch.isHighSurrogate() && character.length() > 1 && character.at(1).isLowSurrogate()){
+			return isWordChar(QChar::surrogateToUcs4(ch, character.at(1)));
+		}
+		return isWordChar(ch.unicode());
+	}
+
+	/**
+	 * @brief Returns the number of leading word characters of the text.
+	 * @param text The text.
+	 * @param length The length of the text.
+	 * @return The offset of the first non-word character, or length.
+	 */
+	static int skipWordChars(const QChar* text, int length);
+
+	/**
+	 * @brief Returns the number of leading non-word characters of the text.
+	 * @param text The text.
+	 * @param length The length of the text.
+	 * @return The offset of the first word character, or length.
+	 */
+	static int skipNonWordChars(const QChar* text, int length);
+
+private:
+	static const Latin1WordTable s_latin1;
+
+	static int scan(const QChar* text, int length, bool word);
+	static int scanScalar(const QChar* text, int pos, int end, int length, bool word);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_WORDCHARS_HPP
@@ -0,0 +1,323 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "WordIndex.hpp"
+#include "DictionaryEncoding.hpp"
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QtDebug>
+#include <algorithm>
+
+namespace QtSpell {
+
+// The parts of a hunspell .aff file needed to tell which stems of the .dic file are correct words by themselves
+struct AffixFlags {
+	enum FlagType { Short, Long, Numeric, Utf8 } flagType = Short;
+	QByteArray encoding;
+	// The flags of stems which are not words by themselves: NEEDAFFIX (or PSEUDOROOT), ONLYINCOMPOUND and FORBIDDENWORD
+	QSet<QString> excluded;
+	// The flag vectors abbreviated by the numbers of the AF directive, starting at 1
+	QList<QString> aliases;
+
+	QStringList split(const QString& flags) const
+	{
+		QStringList list;
+		if(flagType == Numeric){
+			for(const QString& flag : flags.split(',')){
+				if(!flag.isEmpty()){
+					list.append(flag);
+				}
+			}
+		}else if(flagType == Long){
+			for(int i = 0; i + 1 < flags.length(); i += 2){
+				list.append(flags.mid(i, 2));
+			}
+		}else{
+			for(QChar flag : flags){
+				list.append(flag);
+			}
+		}
+		return list;
+	}
+
+	bool isExcluded(const QString& flags) const
+	{
+		QString expanded = flags;
+		bool isAlias = false;
+		int alias = flags.toInt(&isAlias);
+		if(!aliases.isEmpty() && isAlias){
+			expanded = aliases.value(alias - 1);
+		}
+		for(const QString& flag : split(expanded)){
+			if(excluded.contains(flag)){
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+static bool readAffixFlags(const QString& affPath, AffixFlags& affix)
+{
+	QFile affFile(affPath);
+	if(!affFile.open(QIODevice::ReadOnly)){
+		qWarning() << "Failed to open affix file: " << affFile.errorString();
+		return false;
+	}
+	// The directives are ASCII, except for the flags of UTF-8 dictionaries
+	QList<QByteArray> lines;
+	while(!affFile.atEnd()){
+		QByteArray line = affFile.readLine().simplified();
+		if(line.startsWith("SET ")){
+			affix.encoding = line.mid(4).trimmed();
+		}
+		lines.append(line);
+	}
+	DictionaryEncoding encoding;
+	if(!encoding.setEncoding(affix.encoding)){
+		qWarning() << "Unsupported dictionary encoding: " << affix.encoding;
+		return false;
+	}
+	bool firstAlias = true;
+	for(const QByteArray& line : qAsConst(lines)){
+		QList<QString> fields = encoding.decode(line.constData(), line.size()).split(' ');
+		if(fields.size() < 2){
+			continue;
+		}
+		const QString& directive = fields[0];
+		if(directive == "FLAG"){
+			if(fields[1] == "long"){
+				affix.flagType = AffixFlags::Long;
+			}else if(fields[1] == "num"){
+				affix.flagType = AffixFlags::Numeric;
+			}else if(fields[1] == "UTF-8"){
+				affix.flagType = AffixFlags::Utf8;
+			}
+		}else if(directive == "NEEDAFFIX" || directive == "PSEUDOROOT" || directive == "ONLYINCOMPOUND" || directive == "FORBIDDENWORD"){
+			affix.excluded.insert(fields[1]);
+		}else if(directive == "AF"){
+			// The first AF line holds the number of aliases
+			if(firstAlias){
+				firstAlias = false;
+			}else{
+				affix.aliases.append(fields[1]);
+			}
+		}
+	}
+	return true;
+}
+
+// Reads the words of a word list, or the words by themselves of a hunspell .dic file with its .aff file next to it
+static bool readWords(const QString& wordListPath, QVector<QByteArray>& words)
+{
+	QFile listFile(wordListPath);
+	if(!listFile.open(QIODevice::ReadOnly)){
+		qWarning() << "Failed to open word list: " << listFile.errorString();
+		return false;
+	}
+	QFileInfo info(wordListPath);
+	QString affPath = info.path() + "/" + info.completeBaseName() + ".aff";
+	if(info.suffix() != "dic" || !QFile::exists(affPath)){
+		while(!listFile.atEnd()){
+			QByteArray line = listFile.readLine().trimmed();
+			if(!line.isEmpty()){
+				words.append(line);
+			}
+		}
+		return true;
+	}
+
+	AffixFlags affix;
+	if(!readAffixFlags(affPath, affix)){
+		return false;
+	}
+	DictionaryEncoding encoding;
+	encoding.setEncoding(affix.encoding);
+	// The first line holds the approximate number of words
+	listFile.readLine();
+	while(!listFile.atEnd()){
+		QByteArray line = listFile.readLine();
+		QString entry = encoding.decode(line.constData(), line.size()).trimmed();
+		// The morphological fields follow the word after whitespace, the flags after an unescaped slash
+		int end = 0;
+		while(end < entry.length() && !entry.at(end).isSpace() && !(entry.at(end) == '/' && (end == 0 || entry.at(end - 1) != '\\'))){
+			++end;
+		}
+		QString word = entry.left(end);
+		word.replace("\\/", "/");
+		if(word.isEmpty()){
+			continue;
+		}
+		if(end < entry.length() && entry.at(end) == '/'){
+			int flagsEnd = end + 1;
+			while(flagsEnd < entry.length() && !entry.at(flagsEnd).isSpace()){
+				++flagsEnd;
+			}
+			if(affix.isExcluded(entry.mid(end + 1, flagsEnd - end - 1))){
+				continue;
+			}
+		}
+		words.append(word.toUtf8());
+	}
+	return true;
+}
+
+bool WordIndex::build(const QString& wordListPath, const QString& indexPath)
+{
+	QVector<QByteArray> words;
+	if(!readWords(wordListPath, words)){
+		return false;
+	}
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+
+	// Build the trie. As the words are sorted, an existing child for a label is always the last child added.
+	struct TrieNode {
+		bool final = false;
+		QVector<QPair<uchar, int>> children;
+	};
+	QVector<TrieNode> trie(1);
+	for(const QByteArray& word : words){
+		int node = 0;
+		for(char ch : word){
+			uchar label = static_cast<uchar>(ch);
+			if(trie[node].children.isEmpty() || trie[node].children.last().first != label){
+				trie[node].children.append(qMakePair(label, trie.size()));
+				trie.append(TrieNode());
+			}
+			node = trie[node].children.last().second;
+		}
+		trie[node].final = true;
+	}
+
+	// Merge identical subtrees. Children are always created after their parent, so walking the trie backwards
+	// registers all children of a node before the node itself.
+	QVector<Node> nodes;
+	QVector<quint32> targets;
+	QByteArray labels;
+	QVector<quint32> ids(trie.size());
+	QHash<QByteArray, quint32> registry;
+	for(int i = trie.size() - 1; i >= 0; --i){
+		const TrieNode& trieNode = trie[i];
+		QByteArray signature(1, trieNode.final ? '1' : '0');
+		for(const QPair<uchar, int>& child : trieNode.children){
+			quint32 target = ids[child.second];
+			signature.append(static_cast<char>(child.first));
+			signature.append(reinterpret_cast<const char*>(&target), sizeof(target));
+		}
+		auto it = registry.constFind(signature);
+		if(it != registry.constEnd()){
+			ids[i] = it.value();
+			continue;
+		}
+		Node node;
+		node.firstEdge = targets.size();
+		node.edges = trieNode.children.size() | (trieNode.final ? FinalFlag : 0);
+		for(const QPair<uchar, int>& child : trieNode.children){
+			labels.append(static_cast<char>(child.first));
+			targets.append(ids[child.second]);
+		}
+		ids[i] = nodes.size();
+		registry.insert(signature, ids[i]);
+		nodes.append(node);
+	}
+
+	Header header;
+	header.magic = Magic;
+	header.version = Version;
+	header.nodeCount = nodes.size();
+	header.edgeCount = targets.size();
+	header.root = ids[0];
+	QSaveFile indexFile(indexPath);
+	if(!indexFile.open(QIODevice::WriteOnly)){
+		qWarning() << "Failed to create word index: " << indexFile.errorString();
+		return false;
+	}
+	indexFile.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	indexFile.write(reinterpret_cast<const char*>(nodes.constData()), nodes.size() * sizeof(Node));
+	indexFile.write(reinterpret_cast<const char*>(targets.constData()), targets.size() * sizeof(quint32));
+	indexFile.write(labels);
+	if(!indexFile.commit()){
+		qWarning() << "Failed to write word index: " << indexFile.errorString();
+		return false;
+	}
+	return true;
+}
+
+bool WordIndex::load(const QString& indexPath)
+{
+	m_file.setFileName(indexPath);
+	if(!m_file.open(QIODevice::ReadOnly)){
+		qWarning() << "Failed to open word index: " << m_file.errorString();
+		return false;
+	}
+	qint64 size = m_file.size();
+	const uchar* data = size >= qint64(sizeof(Header)) ? m_file.map(0, size) : nullptr;
+	if(!data){
+		qWarning() << "Failed to map word index: " << m_file.errorString();
+		m_file.close();
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(data);
+	qint64 expectedSize = sizeof(Header) + qint64(header->nodeCount) * sizeof(Node) + qint64(header->edgeCount) * (sizeof(quint32) + 1);
+	if(header->magic != Magic || header->version != Version || size != expectedSize || header->root >= header->nodeCount){
+		qWarning() << "Invalid word index: " << indexPath;
+		m_file.close();
+		return false;
+	}
+	m_nodeCount = header->nodeCount;
+	m_edgeCount = header->edgeCount;
+	m_root = header->root;
+	m_nodes = reinterpret_cast<const Node*>(data + sizeof(Header));
+	m_targets = reinterpret_cast<const quint32*>(m_nodes + m_nodeCount);
+	m_labels = reinterpret_cast<const uchar*>(m_targets + m_edgeCount);
+	return true;
+}
+
+bool WordIndex::contains(const char* utf8, int length) const
+{
+	if(!m_nodes){
+		return false;
+	}
+	quint32 node = m_root;
+	for(int i = 0; i < length; ++i){
+		char ch = utf8[i];
+		const Node& n = m_nodes[node];
+		quint32 first = n.firstEdge;
+		quint32 last = first + (n.edges & ~FinalFlag);
+		if(last > m_edgeCount){
+			return false;
+		}
+		const uchar* it = std::lower_bound(m_labels + first, m_labels + last, static_cast<uchar>(ch));
+		if(it == m_labels + last || *it != static_cast<uchar>(ch)){
+			return false;
+		}
+		node = m_targets[it - m_labels];
+		if(node >= m_nodeCount){
+			return false;
+		}
+	}
+	return (m_nodes[node].edges & FinalFlag) != 0;
+}
+
+} // QtSpell
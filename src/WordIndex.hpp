@@ -0,0 +1,93 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_WORDINDEX_HPP
+#define QTSPELL_WORDINDEX_HPP
+
+#include <QFile>
+#include <QString>
+
+namespace QtSpell {
+
+/**
+ * @brief Read-only index of known correct words, stored as a DAWG (directed
+ *        acyclic word graph) over the UTF-8 bytes of the words. The index
+ *        file is memory mapped, so that its pages can be shared between
+ *        processes.
+ */
+class WordIndex
+{
+public:
+	/**
+	 * @brief Builds an index file from a word list.
+	 * @param wordListPath A UTF-8 text file containing one word per line, or
+	 *        a hunspell .dic file with its .aff file next to it. Of a .dic
+	 *        file, only the stems are indexed, in the encoding set in the
+	 *        .aff file, leaving out the stems flagged NEEDAFFIX,
+	 *        ONLYINCOMPOUND or FORBIDDENWORD. The affixed forms are not
+	 *        indexed, to index them pass a list of all forms, i.e. the
+	 *        output of hunspell's unmunch.
+	 * @param indexPath The index file to write.
+	 * @return Whether the index file was written.
+	 */
+	static bool build(const QString& wordListPath, const QString& indexPath);
+
+	/**
+	 * @brief Maps the specified index file.
+	 * @param indexPath The index file, as written by build().
+	 * @return Whether the index file is valid and was mapped.
+	 */
+	bool load(const QString& indexPath);
+
+	/**
+	 * @brief Returns whether the index contains the specified word.
+	 * @param utf8 The UTF-8 encoding of the word.
+	 * @param length The length of the encoding, in bytes.
+	 * @return Whether the word is contained in the index.
+	 */
+	bool contains(const char* utf8, int length) const;
+
+private:
+	struct Header {
+		quint32 magic;
+		quint32 version;
+		quint32 nodeCount;
+		quint32 edgeCount;
+		quint32 root;
+	};
+	// The edges of a node are stored contiguously, sorted by label. The high bit of edges marks the end of a word.
+	struct Node {
+		quint32 firstEdge;
+		quint32 edges;
+	};
+	static constexpr quint32 Magic = 0x49575351; // "QSWI"
+	static constexpr quint32 Version = 1;
+	static constexpr quint32 FinalFlag = 0x80000000;
+
+	QFile m_file;
+	const Node* m_nodes = nullptr;
+	const quint32* m_targets = nullptr;
+	const uchar* m_labels = nullptr;
+	quint32 m_nodeCount = 0;
+	quint32 m_edgeCount = 0;
+	quint32 m_root = 0;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_WORDINDEX_HPP
@@ -0,0 +1,88 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "WordSet.hpp"
+
+namespace QtSpell {
+
+void WordSet::insert(const char* utf8, int length)
+{
+	QByteArray word(utf8, length);
+	if(m_words.contains(word)){
+		return;
+	}
+	m_words.insert(word);
+	// Grow the filter along with the set, which requires setting the bits of all words anew
+	if(qint64(m_filter.size()) * 64 < qint64(m_words.size()) * BitsPerWord){
+		m_filter = QVector<quint64>(qMax(m_filter.size() * 2, 16), 0);
+		for(const QByteArray& w : m_words){
+			setBits(hash(w.constData(), w.size()));
+		}
+	}else{
+		setBits(hash(utf8, length));
+	}
+}
+
+bool WordSet::contains(const char* utf8, int length) const
+{
+	if(m_words.isEmpty()){
+		return false;
+	}
+	// Double hashing: the bit positions are derived from the two halves of the hash
+	quint64 h = hash(utf8, length);
+	quint32 h1 = quint32(h);
+	quint32 h2 = quint32(h >> 32) | 1;
+	quint64 bits = quint64(m_filter.size()) * 64;
+	for(int i = 0; i < HashCount; ++i){
+		quint64 bit = (h1 + quint64(i) * h2) % bits;
+		if(!(m_filter[bit / 64] & (quint64(1) << (bit % 64)))){
+			return false;
+		}
+	}
+	// The word doesn't need to be copied for the lookup
+	return m_words.contains(QByteArray::fromRawData(utf8, length));
+}
+
+void WordSet::clear()
+{
+	m_words.clear();
+	m_filter.clear();
+}
+
+quint64 WordSet::hash(const char* utf8, int length)
+{
+	// FNV-1a
+	quint64 h = 14695981039346656037ull;
+	for(int i = 0; i < length; ++i){
+		h = (h ^ uchar(utf8[i])) * 1099511628211ull;
+	}
+	return h;
+}
+
+void WordSet::setBits(quint64 h)
+{
+	quint32 h1 = quint32(h);
+	quint32 h2 = quint32(h >> 32) | 1;
+	quint64 bits = quint64(m_filter.size()) * 64;
+	for(int i = 0; i < HashCount; ++i){
+		quint64 bit = (h1 + quint64(i) * h2) % bits;
+		m_filter[bit / 64] |= quint64(1) << (bit % 64);
+	}
+}
+
+} // QtSpell
@@ -0,0 +1,72 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_WORDSET_HPP
+#define QTSPELL_WORDSET_HPP
+
+#include <QByteArray>
+#include <QSet>
+#include <QVector>
+
+namespace QtSpell {
+
+/**
+ * @brief Set of UTF-8 encoded words, with a Bloom filter in front of it so
+ *        that most words which are not contained are rejected without
+ *        probing the set.
+ */
+class WordSet
+{
+public:
+	/**
+	 * @brief Adds a word to the set.
+	 * @param utf8 The UTF-8 encoding of the word.
+	 * @param length The length of the encoding, in bytes.
+	 */
+	void insert(const char* utf8, int length);
+
+	/**
+	 * @brief Returns whether the set contains the specified word.
+	 * @param utf8 The UTF-8 encoding of the word.
+	 * @param length The length of the encoding, in bytes.
+	 * @return Whether the word is contained in the set.
+	 */
+	bool contains(const char* utf8, int length) const;
+
+	/**
+	 * @brief Removes all words from the set.
+	 */
+	void clear();
+
+	bool isEmpty() const{ return m_words.isEmpty(); }
+
+private:
+	static const int HashCount = 3;
+	// Bits of the filter per word, for a false positive rate of about 3%
+	static const int BitsPerWord = 8;
+
+	QSet<QByteArray> m_words;
+	QVector<quint64> m_filter;
+
+	static quint64 hash(const char* utf8, int length);
+	void setBits(quint64 h);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_WORDSET_HPP
@@ -0,0 +1,88 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Checks that checking words doesn't allocate once the checker is warmed up. The counting operator new
+// of the benchmarks is linked in, so the test uses the static build of the library, whose allocations go
+// through it as well.
+
+#include "QtSpell.hpp"
+#include "Checker_p.hpp"
+#include "MemoryStats.hpp"
+
+#include <QtTest>
+
+class AllocationTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void checkWord_data();
+	void checkWord();
+};
+
+// Exposes the private data, to check words the way checkSpelling does
+class TestChecker : public QtSpell::TextEditChecker
+{
+public:
+	using QtSpell::Checker::d_ptr;
+};
+
+void AllocationTest::initTestCase()
+{
+	QMap<QString, QList<QString>> wordLists;
+	wordLists.insert("en_US", QList<QString>() << "the" << "quick" << "brown" << "fox" << "internationalization");
+	QtSpell::Backend::setDefault(QtSpell::Backend::createMemoryBackend(wordLists));
+}
+
+void AllocationTest::checkWord_data()
+{
+	QTest::addColumn<QString>("word");
+	QTest::addColumn<bool>("ignored");
+	QTest::newRow("dictionary word") << "quick" << false;
+	QTest::newRow("long dictionary word") << "internationalization" << false;
+	QTest::newRow("ignored word") << "qtspell" << true;
+}
+
+void AllocationTest::checkWord()
+{
+	QFETCH(QString, word);
+	QFETCH(bool, ignored);
+	TestChecker checker;
+	QVERIFY(checker.setLanguage("en_US"));
+	if(ignored){
+		checker.ignoreWord(word);
+	}
+	const QtSpell::CheckerPrivate* d = checker.d_ptr;
+	QVERIFY(!d->speller.isNull());
+	QVERIFY(!d->checkWord(QStringView(QString("qiuck"))));
+	QStringView view(word);
+	// The first check sizes the UTF-8 buffer of the checker
+	QVERIFY(d->checkWord(view));
+
+	MemoryStats::Allocations before = MemoryStats::allocations();
+	bool correct = true;
+	for(int i = 0; i < 10000; ++i){
+		correct = d->checkWord(view) && correct;
+	}
+	MemoryStats::Allocations after = MemoryStats::allocations();
+	QVERIFY(correct);
+	QCOMPARE((after - before).count, quint64(0));
+}
+
+QTEST_MAIN(AllocationTest)
+#include "allocation_test.moc"
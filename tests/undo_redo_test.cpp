@@ -0,0 +1,75 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014-2022 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Checks that undoing and redoing restores the text exactly, including when checking the restored text
+// changes the spelling formats.
+
+#include "QtSpell.hpp"
+
+#include <QSignalSpy>
+#include <QTextEdit>
+#include <QtTest>
+
+class UndoRedoTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void undoRedoUndo();
+};
+
+void UndoRedoTest::initTestCase()
+{
+	QMap<QString, QList<QString>> wordLists;
+	wordLists.insert("en_US", QList<QString>() << "the");
+	QtSpell::Backend::setDefault(QtSpell::Backend::createMemoryBackend(wordLists));
+}
+
+void UndoRedoTest::undoRedoUndo()
+{
+	QTextEdit edit;
+	QtSpell::TextEditChecker checker;
+	QVERIFY(checker.setLanguage("en_US"));
+	checker.setTextEdit(&edit);
+	checker.setUndoRedoEnabled(true);
+
+	// Typed character by character, "teh" is one undo step and the space another
+	QTextCursor cursor = edit.textCursor();
+	for(const QChar& c : QString("teh ")){
+		cursor.insertText(QString(c));
+	}
+	QString typed = edit.toPlainText();
+
+	// Undoing the space rechecks the misspelled word, the format changes must not be recorded as an edit
+	QSignalSpy redoAvailable(&checker, &QtSpell::TextEditChecker::redoAvailable);
+	checker.undo();
+	QString undone = edit.toPlainText();
+	QCOMPARE(undone, QString("teh"));
+	QVERIFY(!redoAvailable.isEmpty());
+	QVERIFY(redoAvailable.last().at(0).toBool());
+
+	checker.redo();
+	QCOMPARE(edit.toPlainText(), typed);
+	checker.undo();
+	QCOMPARE(edit.toPlainText(), undone);
+	checker.undo();
+	QCOMPARE(edit.toPlainText(), QString());
+}
+
+QTEST_MAIN(UndoRedoTest)
+#include "undo_redo_test.moc"